@@ -0,0 +1,239 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "afl.hpp"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 16
+
+/*
+ * The afl::* adapters against the libstdc++ types they replace, driven through the standard guards.
+ * Acquire is timed until the guard is constructed, release from the end of the critical section
+ * until the guard is destroyed. The counters are incremented only under the lock, readers increment atomically.
+ */
+enum
+{
+    SCOPED_MUTEX,
+    UNIQUE_MUTEX,
+    SCOPED_RECURSIVE_MUTEX,
+    SCOPED_SPINLOCK,
+    TIMED_MUTEX,
+    TIMED_RECURSIVE_MUTEX,
+    SCOPED_SHARED_MUTEX,
+    SHARED_SHARED_MUTEX,
+    SCOPED_TWO_MUTEXES,
+    CALL_ONCE,
+    LOCK_COUNT
+};
+
+static size_t std_counters[LOCK_COUNT], afl_counters[LOCK_COUNT];
+
+static std::mutex std_mutex, std_mutex2;
+static std::recursive_mutex std_recursive_mutex;
+static std::timed_mutex std_timed_mutex;
+static std::recursive_timed_mutex std_recursive_timed_mutex;
+static std::shared_mutex std_shared_mutex;
+static std::once_flag std_once_flag;
+
+static afl::mutex afl_mutex, afl_mutex2;
+static afl::recursive_mutex afl_recursive_mutex;
+static afl::spinlock afl_spinlock;
+static afl::shared_mutex afl_shared_mutex;
+static afl::once_flag afl_once_flag;
+
+#define TIMEOUT std::chrono::milliseconds(100)
+
+#define BENCHMARK_GUARD(name, guard, update)                                            \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            {                                                                          \
+                guard;                                                                 \
+                TIMING_NOW(stop);                                                      \
+                TIMING_ADD_DIFF(duration, start, stop);                                \
+                update;                                                                \
+                total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);                       \
+                TIMING_NOW(start);                                                     \
+            }                                                                          \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+#define BENCHMARK_GUARDS(prefix, counters, mutex, mutex2, recursive_mutex, spinlock, timed_mutex,          \
+                         recursive_timed_mutex, shared_mutex, once, call_once)                             \
+    BENCHMARK_GUARD(prefix##_scoped_mutex, std::scoped_lock guard(mutex), counters[SCOPED_MUTEX]++)        \
+    BENCHMARK_GUARD(prefix##_unique_mutex, std::unique_lock guard(mutex), counters[UNIQUE_MUTEX]++)        \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_scoped_recursive_mutex, std::scoped_lock guard(recursive_mutex),                            \
+      counters[SCOPED_RECURSIVE_MUTEX]++                                                                   \
+    )                                                                                                      \
+    BENCHMARK_GUARD(prefix##_scoped_spinlock, std::scoped_lock guard(spinlock), counters[SCOPED_SPINLOCK]++) \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_timed_mutex, std::unique_lock guard(timed_mutex, TIMEOUT), counters[TIMED_MUTEX]++          \
+    )                                                                                                      \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_timed_recursive_mutex, std::unique_lock guard(recursive_timed_mutex, TIMEOUT),              \
+      counters[TIMED_RECURSIVE_MUTEX]++                                                                    \
+    )                                                                                                      \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_scoped_shared_mutex, std::scoped_lock guard(shared_mutex), counters[SCOPED_SHARED_MUTEX]++  \
+    )                                                                                                      \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_shared_shared_mutex, std::shared_lock guard(shared_mutex),                                  \
+      __atomic_add_fetch(&counters[SHARED_SHARED_MUTEX], 1, __ATOMIC_RELAXED)                              \
+    )                                                                                                      \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_scoped_two_mutexes, std::scoped_lock guard(mutex, mutex2), counters[SCOPED_TWO_MUTEXES]++   \
+    )                                                                                                      \
+    BENCHMARK_GUARD(                                                                                       \
+      prefix##_call_once, call_once(once, [] { counters[CALL_ONCE]++; }), (void) 0                         \
+    )
+
+BENCHMARK_GUARDS(
+  std, std_counters, std_mutex, std_mutex2, std_recursive_mutex, std_mutex, std_timed_mutex, std_recursive_timed_mutex,
+  std_shared_mutex, std_once_flag, std::call_once
+)
+BENCHMARK_GUARDS(
+  afl, afl_counters, afl_mutex, afl_mutex2, afl_recursive_mutex, afl_spinlock, afl_mutex, afl_recursive_mutex,
+  afl_shared_mutex, afl_once_flag, afl::call_once
+)
+
+/*
+ * A producer hands items to consumers through std::condition_variable_any waiting on afl::mutex.
+ */
+static void check_condition_variable(void)
+{
+    static afl::mutex mutex;
+    static std::condition_variable_any cond;
+    size_t queued = 0, consumed = 0, items = 100000;
+    bool done = false;
+    std::thread consumers[4];
+
+    for (auto &consumer : consumers)
+        consumer = std::thread([&] {
+            std::unique_lock lock(mutex);
+            for (;;) {
+                cond.wait(lock, [&] { return queued || done; });
+                if (!queued)
+                    break;
+                queued--;
+                consumed++;
+            }
+        });
+
+    for (size_t i = 0; i < items; i++) {
+        std::scoped_lock lock(mutex);
+        queued++;
+        cond.notify_one();
+    }
+
+    {
+        std::scoped_lock lock(mutex);
+        done = true;
+        cond.notify_all();
+    }
+
+    for (auto &consumer : consumers)
+        consumer.join();
+
+    printf("\t condition_variable_any: %zu of %zu\n", consumed, items);
+}
+
+/*
+ * The first callables throw, the flag stays passive until one returns.
+ */
+static void check_call_once(void)
+{
+    static afl::once_flag flag;
+    size_t calls = 0, failures = 0;
+
+#pragma omp parallel for reduction(+ : failures)
+    for (size_t i = 0; i < 1000; i++) {
+        try {
+            afl::call_once(flag, [&] {
+                if (++calls < 4)
+                    throw std::runtime_error("init failed");
+            });
+        } catch (const std::runtime_error &) {
+            failures++;
+        }
+    }
+
+    printf("\t call_once: %zu calls, %zu exceptions\n", calls, failures);
+}
+
+int main(void)
+{
+    static const char *names[LOCK_COUNT] = {
+      "scoped_lock mutex",       "unique_lock mutex",        "scoped_lock recursive", "scoped_lock spinlock",
+      "unique_lock timed",       "unique_lock timed rec.",   "scoped_lock shared",    "shared_lock shared",
+      "scoped_lock two mutexes", "call_once",
+    };
+    benchmark_info std_benchmarks[LOCK_COUNT] = {
+      {.name = "std::mutex", .func = benchmark_std_scoped_mutex},
+      {.name = "std::mutex", .func = benchmark_std_unique_mutex},
+      {.name = "std::recursive_mutex", .func = benchmark_std_scoped_recursive_mutex},
+      {.name = "std::mutex", .func = benchmark_std_scoped_spinlock},
+      {.name = "std::timed_mutex", .func = benchmark_std_timed_mutex},
+      {.name = "std::recursive_timed_mutex", .func = benchmark_std_timed_recursive_mutex},
+      {.name = "std::shared_mutex", .func = benchmark_std_scoped_shared_mutex},
+      {.name = "std::shared_mutex", .func = benchmark_std_shared_shared_mutex},
+      {.name = "std::mutex x2", .func = benchmark_std_scoped_two_mutexes},
+      {.name = "std::call_once", .func = benchmark_std_call_once},
+    };
+    benchmark_info afl_benchmarks[LOCK_COUNT] = {
+      {.name = "afl::mutex", .func = benchmark_afl_scoped_mutex},
+      {.name = "afl::mutex", .func = benchmark_afl_unique_mutex},
+      {.name = "afl::recursive_mutex", .func = benchmark_afl_scoped_recursive_mutex},
+      {.name = "afl::spinlock", .func = benchmark_afl_scoped_spinlock},
+      {.name = "afl::mutex", .func = benchmark_afl_timed_mutex},
+      {.name = "afl::recursive_mutex", .func = benchmark_afl_timed_recursive_mutex},
+      {.name = "afl::shared_mutex", .func = benchmark_afl_scoped_shared_mutex},
+      {.name = "afl::shared_mutex", .func = benchmark_afl_shared_shared_mutex},
+      {.name = "afl::mutex x2", .func = benchmark_afl_scoped_two_mutexes},
+      {.name = "afl::call_once", .func = benchmark_afl_call_once},
+    };
+    size_t expected = (size_t) BENCHMARK_RUNS * RUN_ITERATIONS;
+
+    for (size_t i = 0; i < LOCK_COUNT; i++) {
+        do_bench(&std_benchmarks[i]);
+        do_bench(&afl_benchmarks[i]);
+    }
+
+    for (size_t i = 0; i < LOCK_COUNT; i++)
+        print_benchmark(afl_benchmarks[i], std_benchmarks[i]);
+
+    printf("\t counters (expected %zu, call_once 1):\n", expected);
+    for (size_t i = 0; i < LOCK_COUNT; i++)
+        printf("\t %24s: %zu %zu\n", names[i], std_counters[i], afl_counters[i]);
+
+    check_condition_variable();
+    check_call_once();
+
+    return 0;
+}
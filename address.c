@@ -0,0 +1,176 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 16
+#define RUN_ITERATIONS 32
+#include "benchmark.h"
+
+#define PARK_DELAY_US 100
+
+/*
+ * Wake latency: the waiter blocks in afl_wait_on_address until the word changes, once it had time to park
+ * the main thread stores the next value and wakes it. A round measures the time from the store until
+ * the waiter returns. The futex rows are FUTEX_WAIT and FUTEX_WAKE on a 32-bit word as the primitives open-code them.
+ */
+typedef struct
+{
+    __attribute__((aligned(8))) uint8_t word[8];
+    timing_t start;
+    timing_t woken;
+    size_t ready;
+    size_t waiting;
+    size_t done;
+    size_t count;
+} address_context;
+
+static void wait_counter(size_t *counter, size_t value)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < value)
+        sched_yield();
+}
+
+#define BENCHMARK_ADDRESS_LATENCY(name, type, wait, wake)                    \
+    static void *name##_waiter(void *arg)                                    \
+    {                                                                        \
+        address_context *c = arg;                                            \
+        type *word         = (type *) c->word;                               \
+                                                                             \
+        for (size_t i = 0; i < c->count; i++) {                              \
+            type value = (type) i;                                           \
+            wait_counter(&c->ready, i + 1);                                  \
+            __atomic_add_fetch(&c->waiting, 1, __ATOMIC_RELEASE);            \
+            while (__atomic_load_n(word, __ATOMIC_ACQUIRE) == value)         \
+                wait;                                                        \
+            TIMING_NOW(c->woken);                                            \
+            __atomic_add_fetch(&c->done, 1, __ATOMIC_RELEASE);               \
+        }                                                                    \
+                                                                             \
+        return NULL;                                                         \
+    }                                                                        \
+                                                                             \
+    static timing_t benchmark_##name##_latency(size_t iters)                 \
+    {                                                                        \
+        timing_t duration = 0;                                               \
+        pthread_t thread;                                                    \
+        address_context ctx, *c = &ctx;                                      \
+        type *word = (type *) c->word;                                       \
+                                                                             \
+        memset(c, 0, sizeof(*c));                                            \
+        c->count = iters;                                                    \
+        pthread_create(&thread, NULL, name##_waiter, c);                     \
+                                                                             \
+        for (size_t i = 0; i < iters; i++) {                                 \
+            __atomic_store_n(&c->ready, i + 1, __ATOMIC_RELEASE);            \
+            wait_counter(&c->waiting, i + 1);                                \
+            usleep(PARK_DELAY_US);                                           \
+            TIMING_NOW(c->start);                                            \
+            __atomic_store_n(word, (type) (i + 1), __ATOMIC_RELEASE);        \
+            wake;                                                            \
+            wait_counter(&c->done, i + 1);                                   \
+            TIMING_ADD_CROSS_DIFF(duration, c->start, c->woken);             \
+        }                                                                    \
+                                                                             \
+        pthread_join(thread, NULL);                                          \
+                                                                             \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);              \
+                                                                             \
+        return duration;                                                     \
+    }
+
+/*
+ * Cost without sleeping: the acquire rows time a store and a wake with nobody waiting,
+ * the release rows a wait on a word that no longer holds the compared value.
+ */
+#define BENCHMARK_ADDRESS_COST(name, type, wait, wake)                       \
+    static timing_t benchmark_##name##_cost(size_t iters)                    \
+    {                                                                        \
+        timing_t start, stop, duration = 0;                                  \
+        __attribute__((aligned(8))) type word[1] = {0};                      \
+        type value;                                                          \
+                                                                             \
+        for (size_t i = 0; i < iters; i++) {                                 \
+            value = (type) i;                                                \
+            TIMING_NOW(start);                                               \
+            __atomic_store_n(word, (type) (i + 1), __ATOMIC_RELEASE);        \
+            wake;                                                            \
+            TIMING_NOW(stop);                                                \
+            TIMING_ADD_DIFF(duration, start, stop);                          \
+            TIMING_NOW(start);                                               \
+            wait;                                                            \
+            TIMING_NOW(stop);                                                \
+            TIMING_ADD_RELEASE(duration, start, stop);                       \
+        }                                                                    \
+                                                                             \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);              \
+                                                                             \
+        return duration;                                                     \
+    }
+
+#define BENCHMARK_ADDRESS(name, type)                                                                                \
+    BENCHMARK_ADDRESS_LATENCY(                                                                                       \
+      name, type, afl_wait_on_address(word, &value, sizeof(type), NULL), afl_wake_by_address_single(word)            \
+    )                                                                                                                \
+    BENCHMARK_ADDRESS_COST(                                                                                          \
+      name, type, afl_wait_on_address(word, &value, sizeof(type), NULL), afl_wake_by_address_single(word)            \
+    )
+
+BENCHMARK_ADDRESS(u8, uint8_t)
+BENCHMARK_ADDRESS(u16, uint16_t)
+BENCHMARK_ADDRESS(u32, uint32_t)
+BENCHMARK_ADDRESS(u64, uint64_t)
+
+BENCHMARK_ADDRESS_LATENCY(
+  futex, uint32_t, __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, value, 0),
+  __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0)
+)
+BENCHMARK_ADDRESS_COST(
+  futex, uint32_t, __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, value, 0),
+  __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0)
+)
+
+int main(void)
+{
+    benchmark_info futex_latency = {.name = "futex", .func = benchmark_futex_latency};
+    benchmark_info futex_cost    = {.name = "futex", .func = benchmark_futex_cost};
+    benchmark_info latency[]     = {
+      {.name = "u8", .func = benchmark_u8_latency},
+      {.name = "u16", .func = benchmark_u16_latency},
+      {.name = "u32", .func = benchmark_u32_latency},
+      {.name = "u64", .func = benchmark_u64_latency},
+    };
+    benchmark_info cost[] = {
+      {.name = "u8", .func = benchmark_u8_cost},
+      {.name = "u16", .func = benchmark_u16_cost},
+      {.name = "u32", .func = benchmark_u32_cost},
+      {.name = "u64", .func = benchmark_u64_cost},
+    };
+    size_t count = sizeof(latency) / sizeof(latency[0]);
+
+    do_bench(&futex_latency);
+    do_bench(&futex_cost);
+    for (size_t i = 0; i < count; i++) {
+        do_bench(&latency[i]);
+        do_bench(&cost[i]);
+    }
+
+    printf("\n\n\t wake latency");
+    for (size_t i = 0; i < count; i++)
+        print_benchmark(latency[i], futex_latency);
+
+    printf("\n\n\t wake and wait cost without sleeping");
+    for (size_t i = 0; i < count; i++)
+        print_benchmark(cost[i], futex_cost);
+
+    return 0;
+}
@@ -4,10 +4,12 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <stdatomic.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <linux/futex.h>
@@ -102,6 +104,22 @@ extern "C"
 #define __afl_syscall_check_errors(ret)
 #endif
 
+/*
+ * Count system calls made by Atomic Fast Locks. Used by benchmarks to compare slow paths.
+ */
+#ifdef AFL_COUNT_SYSCALLS
+static inline uint64_t *__afl_syscalls_counter(void)
+{
+    static uint64_t counter;
+    return &counter;
+}
+#define __afl_syscall_count() __atomic_add_fetch(__afl_syscalls_counter(), 1, __ATOMIC_RELAXED)
+#define afl_syscalls_count() __atomic_load_n(__afl_syscalls_counter(), __ATOMIC_RELAXED)
+#else
+#define __afl_syscall_count()
+#define afl_syscalls_count() ((uint64_t) 0)
+#endif
+
 /*
  * Pause Thread
  *
@@ -170,6 +188,7 @@ static inline int32_t __afl_syscall(int64_t number, int64_t p1, int64_t p2, int6
                  : "=a"(ret)
                  : "a"(number), "D"(p1), "S"(p2), "d"(p3), "r"(r10), "r"(r8), "r"(r9)
                  : "rcx", "r11", "memory");
+    __afl_syscall_count();
     __afl_syscall_check_errors(ret);
     return ret;
 }
@@ -187,6 +206,7 @@ static inline int32_t __afl_syscall(int32_t number, int32_t p1, int32_t p2, int3
                  : "a"(number), "D"(p1), "c"(p2), "d"(p3), "S"(p4)
                  : "memory");
 #endif
+    __afl_syscall_count();
     __afl_syscall_check_errors(ret);
     return ret;
 }
@@ -201,6 +221,7 @@ static inline int64_t __afl_syscall(int64_t number, int64_t p1, int64_t p2, int6
     register int64_t x4 __asm__("x4") = 0;
     register int64_t x5 __asm__("x5") = 0;
     asm volatile("svc 0" : "=r"(x0) : "r"(x8), "0"(x0), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5) : "cc", "memory");
+    __afl_syscall_count();
     __afl_syscall_check_errors(x0);
     return x0;
 }
@@ -209,379 +230,3737 @@ static inline int64_t __afl_syscall(int64_t number, int64_t p1, int64_t p2, int6
 #endif
 
 /*
- * Caches the syscall gettid and stores Thread ID in TLS.
- * This improves performance and reduces the number of system calls.
+ * System calls with six arguments: FUTEX_CMP_REQUEUE, FUTEX_WAIT_BITSET and FUTEX_WAKE_BITSET
+ * pass uaddr2 and val3 in the fifth and sixth arguments.
+ * Returns negative errno on error like __afl_syscall.
  */
-static inline uint32_t __afl_gettid(void)
+#if defined(__x86_64__) || defined(__amd64__)
+static inline int32_t __afl_syscall6(
+  int64_t number, int64_t p1, int64_t p2, int64_t p3, int64_t p4, int64_t p5, int64_t p6
+)
 {
-    static __thread uint32_t tid;
-
-    if (__afl_likely(tid))
-        return tid;
+    int32_t ret;
+    register int64_t r8 __asm__("r8")   = p5;
+    register int64_t r9 __asm__("r9")   = p6;
+    register int64_t r10 __asm__("r10") = p4;
+    asm volatile("syscall"
+                 : "=a"(ret)
+                 : "a"(number), "D"(p1), "S"(p2), "d"(p3), "r"(r10), "r"(r8), "r"(r9)
+                 : "rcx", "r11", "memory");
+    __afl_syscall_count();
+    __afl_syscall_check_errors(ret);
+    return ret;
+}
+#elif defined(__aarch64__)
+static inline int64_t __afl_syscall6(
+  int64_t number, int64_t p1, int64_t p2, int64_t p3, int64_t p4, int64_t p5, int64_t p6
+)
+{
+    register int64_t x8 __asm__("x8") = number;
+    register int64_t x0 __asm__("x0") = p1;
+    register int64_t x1 __asm__("x1") = p2;
+    register int64_t x2 __asm__("x2") = p3;
+    register int64_t x3 __asm__("x3") = p4;
+    register int64_t x4 __asm__("x4") = p5;
+    register int64_t x5 __asm__("x5") = p6;
+    asm volatile("svc 0" : "=r"(x0) : "r"(x8), "0"(x0), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5) : "cc", "memory");
+    __afl_syscall_count();
+    __afl_syscall_check_errors(x0);
+    return x0;
+}
+#else
+static inline long __afl_syscall6(long number, long p1, long p2, long p3, long p4, long p5, long p6)
+{
+    long ret = syscall(number, p1, p2, p3, p4, p5, p6);
+    __afl_syscall_count();
+    return ret == -1 ? -errno : ret;
+}
+#endif
 
-    tid = __afl_syscall(__NR_gettid, 0, 0, 0, 0) & AFL_TID_MASK;
+/*
+ * Wait on a futex word until an absolute CLOCK_MONOTONIC deadline, NULL waits forever.
+ * FUTEX_WAIT takes a relative timeout, which would have to be recomputed after every spurious wakeup.
+ */
+static inline int __afl_futex_wait_until(uint32_t *futex, uint32_t value, const struct timespec *abstime)
+{
+    return __afl_syscall6(
+      __NR_futex, (intptr_t) futex, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, value, (intptr_t) abstime, 0,
+      FUTEX_BITSET_MATCH_ANY
+    );
+}
 
-    return tid;
+/*
+ * Convert a relative timeout to an absolute CLOCK_MONOTONIC deadline.
+ */
+static inline void __afl_deadline(struct timespec *abstime, const struct timespec *timeout)
+{
+    clock_gettime(CLOCK_MONOTONIC, abstime);
+    abstime->tv_sec += timeout->tv_sec;
+    abstime->tv_nsec += timeout->tv_nsec;
+    if (abstime->tv_nsec >= 1000000000) {
+        abstime->tv_sec++;
+        abstime->tv_nsec -= 1000000000;
+    }
 }
 
-enum __afl_state
+static inline int __afl_deadline_passed(const struct timespec *abstime)
 {
-    AFL_UNLOCKED = 0, // Unlocked
-    AFL_LOCKED   = 1  // Locked
-};
+    struct timespec now;
 
-#define AFL_HAVE_WAITERS 0x80000000 // Lock have waiters bit mask
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-#define __AFL_ALIGN __attribute__((aligned(64))) // Most processors have a cache line size of 64 bytes
+    return now.tv_sec > abstime->tv_sec || (now.tv_sec == abstime->tv_sec && now.tv_nsec >= abstime->tv_nsec);
+}
 
 /*
- * Spinlock
+ * A deadline futex rejects with EINVAL: negative or with nanoseconds out of range. Checked before blocking,
+ * so a timed lock returns EINVAL instead of retrying the wait forever.
  */
-typedef __AFL_ALIGN uint32_t afl_spinlock_t;
-
-static inline int afl_spin_init(afl_spinlock_t *spinlock, int shared)
+static inline int __afl_deadline_invalid(const struct timespec *abstime)
 {
-    (void) shared;
-    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
-    return 0;
+    return abstime && (abstime->tv_sec < 0 || abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000);
 }
 
-static inline int afl_spin_lock(afl_spinlock_t *spinlock)
+/*
+ * Registers the pthread_atfork child handler once. The first caller moves the word from 0 to 1 and registers,
+ * concurrent callers sleep until it stores 2, so no thread returns and forks before the handler is in place.
+ */
+static inline void __afl_atfork(uint32_t *registered, void (*child)(void))
 {
-    uint32_t lock;
+    uint32_t state = __atomic_load_n(registered, __ATOMIC_ACQUIRE);
 
-    if (__afl_likely(!__atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE)))
-        return 0;
+    if (__afl_likely(state == 2))
+        return;
 
-loop:
-    __afl_pause;
-    lock = __atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE);
-    if (lock != AFL_UNLOCKED)
-        goto loop;
+    if (!state && __atomic_compare_exchange_n(registered, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        pthread_atfork(NULL, NULL, child);
+        __atomic_store_n(registered, 2, __ATOMIC_RELEASE);
+        __afl_syscall(__NR_futex, (intptr_t) registered, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+        return;
+    }
 
-    return 0;
+    while (__atomic_load_n(registered, __ATOMIC_ACQUIRE) != 2)
+        __afl_futex_wait_until(registered, 1, NULL);
 }
 
-static inline int afl_spin_unlock(afl_spinlock_t *spinlock)
+/*
+ * Caches the syscall gettid and stores Thread ID in TLS.
+ * This improves performance and reduces the number of system calls.
+ *
+ * The child of fork inherits the TLS of the forking thread, so the cache is cleared by a pthread_atfork handler,
+ * otherwise the child would take locks in shared memory with the Thread ID of its parent.
+ */
+static inline uint32_t *__afl_gettid_cache(void)
 {
-    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
-    return 0;
+    static __thread uint32_t tid;
+    return &tid;
 }
 
-static inline int afl_spin_owner_lock(afl_spinlock_t *spinlock)
+static inline void __afl_gettid_reset(void)
 {
-    uint32_t lock;
-    uint32_t tid = __afl_thread_pointer_tid();
+    *__afl_gettid_cache() = 0;
+}
 
-    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+static inline uint32_t __afl_gettid(void)
+{
+    static uint32_t atfork;
+    uint32_t *tid = __afl_gettid_cache();
 
-    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned spinlock.");
+    if (__afl_likely(*tid))
+        return *tid;
 
-    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
-        return EDEADLOCK;
+    __afl_atfork(&atfork, __afl_gettid_reset);
 
-loop:
-    lock = AFL_UNLOCKED;
-    if (__atomic_compare_exchange_n(spinlock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-        return 0;
-    __afl_pause;
-    goto loop;
+    *tid = __afl_syscall(__NR_gettid, 0, 0, 0, 0) & AFL_TID_MASK;
 
-    return 0;
+    return *tid;
 }
 
-static inline int afl_spin_owner_unlock(afl_spinlock_t *spinlock)
+enum __afl_state
 {
-    uint32_t lock = 0;
-    uint32_t tid  = __afl_thread_pointer_tid();
+    AFL_UNLOCKED = 0, // Unlocked
+    AFL_LOCKED   = 1  // Locked
+};
 
-    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+#define AFL_HAVE_WAITERS 0x80000000 // Lock have waiters bit mask
 
-    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a spinlock from a non-owner thread.");
+#define __AFL_ALIGN __attribute__((aligned(64))) // Most processors have a cache line size of 64 bytes
 
-    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
-        return EPERM;
+/*
+ * Lock Statistics
+ *
+ * Build with -DAFL_STATS to count per lock: acquisitions, contended acquisitions, futex waits, futex wakes,
+ * spin iterations and log2 histograms of wait and hold time. Bucket i counts durations of [2^i, 2^(i+1)) ticks
+ * of __afl_stats_clock: TSC on x86, the virtual counter on aarch64, nanoseconds elsewhere.
+ *
+ * The counters live in a side table keyed by lock address, so afl_mutex_t and friends keep their layout.
+ * Every acquisition costs one table probe and one timestamp, the counters of a held lock are updated
+ * by its owner without atomics and only the futex counters, touched outside the lock, are atomic.
+ * Instrumented: afl_mutex_*, afl_mutex_owner_*, afl_mutex_adaptive_* and the afl_spin_* algorithms.
+ *
+ * Entries are never removed: a lock placed at the address of a destroyed one continues its counters.
+ * When the table is full new locks are not counted. All translation units of a program share the table,
+ * so AFL_STATS_TABLE_BITS must be the same in all of them. Without AFL_STATS every hook compiles to nothing.
+ */
+#ifdef AFL_STATS
+#include <inttypes.h>
+#include <stddef.h>
 
-    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+#ifndef AFL_STATS_TABLE_BITS
+#define AFL_STATS_TABLE_BITS 10
+#endif
 
-    return 0;
-}
+#define AFL_STATS_TABLE_SIZE (1 << AFL_STATS_TABLE_BITS)
+#define AFL_STATS_HISTOGRAM_BUCKETS 32
 
-static inline int afl_spin_destroy(afl_spinlock_t *spinlock)
+typedef struct
 {
-    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
-    return 0;
-}
+    const void *lock;
+    const char *name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t futex_waits;
+    uint64_t futex_wakes;
+    uint64_t spins;
+    uint64_t acquired_at;
+    uint64_t wait_histogram[AFL_STATS_HISTOGRAM_BUCKETS];
+    uint64_t hold_histogram[AFL_STATS_HISTOGRAM_BUCKETS];
+} __AFL_ALIGN afl_lock_stats_t;
 
 /*
- * Mutex
+ * A weak symbol, so every translation unit of a program counts into and dumps the same table.
  */
-typedef __AFL_ALIGN uint32_t afl_mutex_t;
+__attribute__((weak)) afl_lock_stats_t __afl_stats_locks[AFL_STATS_TABLE_SIZE];
 
-#define AFL_MUTEX_INIT 0
+static inline afl_lock_stats_t *__afl_stats_table(void)
+{
+    return __afl_stats_locks;
+}
 
-static inline int afl_mutex_lock(afl_mutex_t *mutex)
+static inline uint64_t __afl_stats_clock(void)
 {
-    uint32_t lock;
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * UINT64_C(1000000000) + now.tv_nsec;
+#endif
+}
 
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+static inline uint32_t __afl_stats_bucket(uint64_t ticks)
+{
+    uint32_t bucket = 63 - __builtin_clzll(ticks | 1);
+    return bucket < AFL_STATS_HISTOGRAM_BUCKETS ? bucket : AFL_STATS_HISTOGRAM_BUCKETS - 1;
+}
 
-    if (lock & AFL_HAVE_WAITERS)
-        goto futex;
+/*
+ * Find the entry of a lock, claiming a free slot with linear probing on the first use.
+ */
+static inline afl_lock_stats_t *__afl_stats_get(const void *lock)
+{
+    afl_lock_stats_t *table = __afl_stats_table();
+    uint32_t hash = (uint32_t) ((((uintptr_t) lock >> 6) * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - AFL_STATS_TABLE_BITS));
 
-    lock = AFL_UNLOCKED;
-    if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
-        return 0;
+    for (uint32_t i = 0; i < AFL_STATS_TABLE_SIZE; i++) {
+        afl_lock_stats_t *stats = &table[(hash + i) & (AFL_STATS_TABLE_SIZE - 1)];
+        const void *key         = __atomic_load_n(&stats->lock, __ATOMIC_ACQUIRE);
 
-    if (!(lock & AFL_HAVE_WAITERS))
-        __atomic_compare_exchange_n(mutex, &lock, AFL_LOCKED | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+        if (__afl_likely(key == lock))
+            return stats;
 
-    while (lock != AFL_UNLOCKED) {
-    futex:
-        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
-        lock = __atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (!key && __atomic_compare_exchange_n(&stats->lock, &key, lock, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return stats;
+
+        if (key == lock)
+            return stats;
     }
 
-    return 0;
+    return NULL;
 }
 
-static inline int afl_mutex_unlock(afl_mutex_t *mutex)
+static inline void __afl_stats_acquire(const void *lock, uint64_t start, uint32_t spins)
 {
-    uint32_t lock;
+    afl_lock_stats_t *stats = __afl_stats_get(lock);
+    uint64_t now            = __afl_stats_clock();
 
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
-
-    __afl_debug(lock == AFL_UNLOCKED, "An attempt was made to unlock an unlocked mutex.");
+    if (__afl_unlikely(stats == NULL))
+        return;
 
-    if (__atomic_exchange_n(mutex, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS)
-        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+    stats->acquisitions++;
+    stats->acquired_at = now;
 
-    return 0;
+    if (start) {
+        stats->contended++;
+        stats->spins += spins;
+        stats->wait_histogram[__afl_stats_bucket(now - start)]++;
+    }
 }
 
-static inline int afl_mutex_owner_lock(afl_mutex_t *mutex)
+static inline void __afl_stats_release(const void *lock)
 {
-    uint32_t lock;
-    uint32_t tid = __afl_thread_pointer_tid();
+    afl_lock_stats_t *stats = __afl_stats_get(lock);
 
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+    if (__afl_likely(stats != NULL))
+        stats->hold_histogram[__afl_stats_bucket(__afl_stats_clock() - stats->acquired_at)]++;
+}
 
-    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+static inline void __afl_stats_add(const void *lock, size_t offset)
+{
+    afl_lock_stats_t *stats = __afl_stats_get(lock);
 
-    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
-        return EDEADLOCK;
+    if (__afl_likely(stats != NULL))
+        __atomic_add_fetch((uint64_t *) ((char *) stats + offset), 1, __ATOMIC_RELAXED);
+}
 
-    if (__afl_likely(!lock && __atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
-        return 0;
+#define __afl_stats_begin(start) uint64_t start = __afl_stats_clock()
+#define __afl_stats_acquired(lock) __afl_stats_acquire((lock), 0, 0)
+#define __afl_stats_contended(lock, start, spins) __afl_stats_acquire((lock), (start), (spins))
+#define __afl_stats_released(lock) __afl_stats_release(lock)
+#define __afl_stats_futex_wait(lock) __afl_stats_add((lock), offsetof(afl_lock_stats_t, futex_waits))
+#define __afl_stats_futex_wake(lock) __afl_stats_add((lock), offsetof(afl_lock_stats_t, futex_wakes))
 
-try_lock:
-    if (!(lock & AFL_HAVE_WAITERS)) {
-        lock = __atomic_or_fetch(mutex, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
-        if (lock == AFL_HAVE_WAITERS
-            && __atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-            return 0;
-    }
+/*
+ * Name a lock for afl_stats_dump. The string is not copied and must outlive the table.
+ */
+static inline int afl_stats_register(const void *lock, const char *name)
+{
+    afl_lock_stats_t *stats = __afl_stats_get(lock);
 
-    __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock, 0);
-    lock = AFL_UNLOCKED;
-    if (!__atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-        goto try_lock;
+    if (__afl_unlikely(stats == NULL))
+        return ENOMEM;
+
+    __atomic_store_n(&stats->name, name, __ATOMIC_RELEASE);
 
     return 0;
 }
 
-static inline int afl_mutex_owner_unlock(afl_mutex_t *mutex)
+static inline const afl_lock_stats_t *afl_stats_get(const void *lock)
 {
-    uint32_t lock;
-    uint32_t tid = __afl_thread_pointer_tid();
-
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
-
-    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
-
-    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
-        return EPERM;
+    return __afl_stats_get(lock);
+}
 
-    if (__atomic_exchange_n(mutex, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS)
-        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+static inline void afl_stats_foreach(void (*callback)(const afl_lock_stats_t *stats, void *arg), void *arg)
+{
+    afl_lock_stats_t *table = __afl_stats_table();
 
-    return 0;
+    for (uint32_t i = 0; i < AFL_STATS_TABLE_SIZE; i++)
+        if (__atomic_load_n(&table[i].lock, __ATOMIC_ACQUIRE))
+            callback(&table[i], arg);
 }
 
-static inline int afl_mutex_pi_lock(afl_mutex_t *mutex)
+static inline void __afl_stats_dump_histogram(FILE *file, const char *title, const uint64_t *histogram)
 {
-    uint32_t lock;
-    uint32_t tid = __afl_gettid();
+    fprintf(file, "    %s:", title);
+    for (uint32_t i = 0; i < AFL_STATS_HISTOGRAM_BUCKETS; i++)
+        if (histogram[i])
+            fprintf(file, " 2^%u:%" PRIu64, i, histogram[i]);
+    fprintf(file, "\n");
+}
 
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+static inline void __afl_stats_dump_lock(const afl_lock_stats_t *stats, void *arg)
+{
+    FILE *file = (FILE *) arg;
+
+    fprintf(
+      file, "%s (%p): acquisitions %" PRIu64 ", contended %" PRIu64 ", futex waits %" PRIu64 ", futex wakes %" PRIu64
+            ", spins %" PRIu64 "\n",
+      stats->name ? stats->name : "unnamed", stats->lock, stats->acquisitions, stats->contended, stats->futex_waits,
+      stats->futex_wakes, stats->spins
+    );
+    __afl_stats_dump_histogram(file, "wait", stats->wait_histogram);
+    __afl_stats_dump_histogram(file, "hold", stats->hold_histogram);
+}
 
-    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+static inline void afl_stats_dump(FILE *file)
+{
+    afl_stats_foreach(__afl_stats_dump_lock, file);
+}
 
-    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
-        return EDEADLOCK;
+#else
+#define __afl_stats_begin(start)
+#define __afl_stats_acquired(lock)
+#define __afl_stats_contended(lock, start, spins) ((void) (spins))
+#define __afl_stats_released(lock)
+#define __afl_stats_futex_wait(lock)
+#define __afl_stats_futex_wake(lock)
+#endif
 
-    if (lock || (!lock && !__atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
-        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_LOCK_PI | FUTEX_PRIVATE_FLAG, 0, 0);
+/*
+ * Spinlock
+ */
+typedef __AFL_ALIGN uint32_t afl_spinlock_t;
 
+/*
+ * Spinlocks never call futex, so afl_spin_lock works in memory shared between processes whatever `shared` is.
+ * afl_spin_owner_lock records the TLS-pointer-derived owner, which is only unique inside one process.
+ */
+static inline int afl_spin_init(afl_spinlock_t *spinlock, int shared)
+{
+    (void) shared;
+    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
     return 0;
 }
 
-static inline int afl_mutex_pi_unlock(afl_mutex_t *mutex)
+/*
+ * Test-and-set: every spin iteration is an atomic exchange.
+ */
+static inline int afl_spin_exchange_lock(afl_spinlock_t *spinlock)
 {
     uint32_t lock;
-    uint32_t tid = __afl_gettid();
+    uint32_t spins = 0;
 
-    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+    if (__afl_likely(!__atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE))) {
+        __afl_stats_acquired(spinlock);
+        return 0;
+    }
 
-    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+    __afl_stats_begin(start);
 
-    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
-        return EPERM;
+loop:
+    __afl_pause;
+    spins++;
+    lock = __atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE);
+    if (lock != AFL_UNLOCKED)
+        goto loop;
 
-    if (!__atomic_compare_exchange_n(mutex, &tid, AFL_UNLOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_UNLOCK_PI | FUTEX_PRIVATE_FLAG, 0, 0);
+    __afl_stats_contended(spinlock, start, spins);
 
     return 0;
 }
 
-static inline int afl_mutex_destroy(afl_mutex_t *mutex)
+static inline int afl_spin_exchange_unlock(afl_spinlock_t *spinlock)
 {
-    __atomic_store_n(mutex, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    __afl_stats_released(spinlock);
+    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
     return 0;
 }
 
 /*
- * Recursive Mutex
+ * Test-and-test-and-set with exponential backoff.
+ *
+ * Waiters spin on a plain load, so the cache line stays shared until the lock is released,
+ * and only try the exchange when the lock looks free. After every failed exchange the number of pauses
+ * between attempts doubles up to AFL_SPIN_BACKOFF_MAX, which spreads out the waiters.
  */
-typedef struct
-{
-    __attribute__((aligned(8))) uint32_t lock;
-    size_t count;
-} __AFL_ALIGN afl_mutex_recursive_t;
+#define AFL_SPIN_BACKOFF_MIN 4
+#define AFL_SPIN_BACKOFF_MAX 1024
 
-static inline int afl_mutex_recursive_init(afl_mutex_recursive_t *mutex)
+static inline int afl_spin_ttas_lock(afl_spinlock_t *spinlock)
 {
-    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
-    mutex->count = 0;
+    uint32_t lock;
+    uint32_t backoff = AFL_SPIN_BACKOFF_MIN;
+    uint32_t spins   = 0;
 
-    return 0;
-}
+    if (__afl_likely(!__atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE))) {
+        __afl_stats_acquired(spinlock);
+        return 0;
+    }
 
-static inline int afl_mutex_recursive_lock(afl_mutex_recursive_t *mutex)
+    __afl_stats_begin(start);
+
+loop:
+    for (uint32_t i = 0; i < backoff; i++)
+        __afl_pause;
+
+    spins += backoff;
+    if (backoff < AFL_SPIN_BACKOFF_MAX)
+        backoff <<= 1;
+
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+    if (lock != AFL_UNLOCKED || __atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE) != AFL_UNLOCKED)
+        goto loop;
+
+    __afl_stats_contended(spinlock, start, spins);
+
+    return 0;
+}
+
+static inline int afl_spin_ttas_unlock(afl_spinlock_t *spinlock)
 {
-    uint32_t lock;
-    uint32_t tid = __afl_thread_pointer_tid();
+    __afl_stats_released(spinlock);
+    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    return 0;
+}
 
-    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+/*
+ * FIFO ticket lock.
+ *
+ * The upper 16 bits hold the next ticket, the lower 16 bits hold the ticket being served.
+ * Every waiter takes one atomic increment and then only reads the lock word,
+ * pausing in proportion to its distance from the head of the queue.
+ */
+#define AFL_TICKET_SHIFT 16
+#define AFL_TICKET_MASK 0xFFFF
 
-    if (__afl_likely(
-          !lock && __atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
-        ))
-        goto success;
+static inline int afl_spin_ticket_lock(afl_spinlock_t *spinlock)
+{
+    uint32_t lock   = __atomic_fetch_add(spinlock, 1 << AFL_TICKET_SHIFT, __ATOMIC_ACQUIRE);
+    uint32_t ticket = lock >> AFL_TICKET_SHIFT;
+    uint32_t spins  = 0;
 
-    if (__afl_likely(tid == (lock & AFL_TID_MASK))) {
-        __afl_debug(
-          mutex->count + 1 == 0,
-          "Recusive mutex counter overflow. "
-          "This is not an error, but please check that the EAGAIN return value is being processed correctly."
-        );
-        if (__afl_unlikely(mutex->count + 1 == 0))
-            return EAGAIN;
-        mutex->count++;
+    if (__afl_likely((lock & AFL_TICKET_MASK) == ticket)) {
+        __afl_stats_acquired(spinlock);
         return 0;
     }
 
-try_lock:
-    if (!(lock & AFL_HAVE_WAITERS)) {
-        lock = __atomic_or_fetch(&mutex->lock, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
-        if (lock == AFL_HAVE_WAITERS
-            && __atomic_compare_exchange_n(
-              &mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
-            ))
-            goto success;
+    __afl_stats_begin(start);
+
+    while ((lock & AFL_TICKET_MASK) != ticket) {
+        for (uint32_t i = (ticket - lock) & AFL_TICKET_MASK; i; i--, spins++)
+            __afl_pause;
+        __atomic_load(spinlock, &lock, __ATOMIC_ACQUIRE);
     }
 
-    __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock, 0);
-    lock = AFL_UNLOCKED;
-    if (!__atomic_compare_exchange_n(&mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-        goto try_lock;
+    __afl_stats_contended(spinlock, start, spins);
 
-success:
-    mutex->count = 1;
+    return 0;
+}
+
+static inline int afl_spin_ticket_unlock(afl_spinlock_t *spinlock)
+{
+    uint32_t lock;
+
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(
+      (lock & AFL_TICKET_MASK) == lock >> AFL_TICKET_SHIFT, "An attempt was made to unlock an unlocked ticket spinlock."
+    );
+
+    __afl_stats_released(spinlock);
+
+    while (!__atomic_compare_exchange_n(
+      spinlock, &lock, (lock & ~AFL_TICKET_MASK) | ((lock + 1) & AFL_TICKET_MASK), 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED
+    ))
+        ;
 
     return 0;
 }
 
-static inline int afl_mutex_recursive_unlock(afl_mutex_recursive_t *mutex)
+static inline int afl_spin_ticket_trylock(afl_spinlock_t *spinlock)
+{
+    uint32_t lock;
+
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+
+    if ((lock & AFL_TICKET_MASK) != lock >> AFL_TICKET_SHIFT)
+        return EBUSY;
+
+    if (!__atomic_compare_exchange_n(
+          spinlock, &lock, lock + (1 << AFL_TICKET_SHIFT), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+        ))
+        return EBUSY;
+
+    __afl_stats_acquired(spinlock);
+
+    return 0;
+}
+
+/*
+ * Select the algorithm behind afl_spin_lock and afl_spin_unlock at compile time:
+ * -DAFL_SPINLOCK_ALGORITHM=AFL_SPINLOCK_TTAS or -DAFL_SPINLOCK_ALGORITHM=AFL_SPINLOCK_TICKET.
+ * All of them use the same afl_spinlock_t word and afl_spin_init.
+ */
+#define AFL_SPINLOCK_EXCHANGE 0
+#define AFL_SPINLOCK_TTAS 1
+#define AFL_SPINLOCK_TICKET 2
+
+#ifndef AFL_SPINLOCK_ALGORITHM
+#define AFL_SPINLOCK_ALGORITHM AFL_SPINLOCK_EXCHANGE
+#endif
+
+static inline int afl_spin_lock(afl_spinlock_t *spinlock)
+{
+#if AFL_SPINLOCK_ALGORITHM == AFL_SPINLOCK_TTAS
+    return afl_spin_ttas_lock(spinlock);
+#elif AFL_SPINLOCK_ALGORITHM == AFL_SPINLOCK_TICKET
+    return afl_spin_ticket_lock(spinlock);
+#else
+    return afl_spin_exchange_lock(spinlock);
+#endif
+}
+
+static inline int afl_spin_unlock(afl_spinlock_t *spinlock)
+{
+#if AFL_SPINLOCK_ALGORITHM == AFL_SPINLOCK_TTAS
+    return afl_spin_ttas_unlock(spinlock);
+#elif AFL_SPINLOCK_ALGORITHM == AFL_SPINLOCK_TICKET
+    return afl_spin_ticket_unlock(spinlock);
+#else
+    return afl_spin_exchange_unlock(spinlock);
+#endif
+}
+
+static inline int afl_spin_trylock(afl_spinlock_t *spinlock)
+{
+#if AFL_SPINLOCK_ALGORITHM == AFL_SPINLOCK_TICKET
+    return afl_spin_ticket_trylock(spinlock);
+#else
+    uint32_t lock;
+
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+
+    if (lock != AFL_UNLOCKED || __atomic_exchange_n(spinlock, AFL_LOCKED, __ATOMIC_ACQUIRE) != AFL_UNLOCKED)
+        return EBUSY;
+
+    __afl_stats_acquired(spinlock);
+
+    return 0;
+#endif
+}
+
+/*
+ * Spin until an absolute CLOCK_MONOTONIC deadline. A queued ticket cannot be abandoned,
+ * so every algorithm polls afl_spin_trylock and reads the clock every AFL_SPIN_CLOCK_PERIOD pauses.
+ */
+#define AFL_SPIN_CLOCK_PERIOD 64
+
+static inline int afl_spin_timedlock(afl_spinlock_t *spinlock, const struct timespec *abstime)
+{
+    if (__afl_likely(!afl_spin_trylock(spinlock)))
+        return 0;
+
+loop:
+    for (size_t i = 0; i < AFL_SPIN_CLOCK_PERIOD; i++) {
+        __afl_pause;
+        if (!afl_spin_trylock(spinlock))
+            return 0;
+    }
+
+    if (!__afl_deadline_passed(abstime))
+        goto loop;
+
+    return ETIMEDOUT;
+}
+
+static inline int afl_spin_reltimedlock(afl_spinlock_t *spinlock, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_spin_timedlock(spinlock, &abstime);
+}
+
+static inline int afl_spin_owner_lock(afl_spinlock_t *spinlock)
 {
     uint32_t lock;
     uint32_t tid = __afl_thread_pointer_tid();
 
-    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
 
-    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned spinlock.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+loop:
+    lock = AFL_UNLOCKED;
+    if (__atomic_compare_exchange_n(spinlock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return 0;
+    __afl_pause;
+    goto loop;
+
+    return 0;
+}
+
+static inline int afl_spin_owner_unlock(afl_spinlock_t *spinlock)
+{
+    uint32_t lock = 0;
+    uint32_t tid  = __afl_thread_pointer_tid();
+
+    __atomic_load(spinlock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a spinlock from a non-owner thread.");
 
     if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
         return EPERM;
 
-    __afl_debug(mutex->count == 0, "An attempt was made to unlock an unlocked recursive mutex.");
+    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
 
-    if (--mutex->count == 0 && (__atomic_exchange_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS))
-        __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+    return 0;
+}
 
+static inline int afl_spin_destroy(afl_spinlock_t *spinlock)
+{
+    __atomic_store_n(spinlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
     return 0;
 }
 
-static inline int afl_mutex_recursive_destroy(afl_mutex_recursive_t *mutex)
+/*
+ * MCS queue spinlock
+ *
+ * The lock is the tail of a queue of waiter nodes. Every waiter spins on the flag in its own node,
+ * aligned to its own cache line, and the owner hands the lock to the next node on unlock,
+ * so releasing the lock touches only the cache line of one waiter.
+ *
+ * The node is passed to both lock and unlock and must stay valid until unlock returns.
+ */
+typedef struct afl_spin_mcs_node
 {
-    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
-    mutex->count = 0;
+    struct afl_spin_mcs_node *next;
+    uint32_t locked;
+} __AFL_ALIGN afl_spin_mcs_node_t;
+
+typedef afl_spin_mcs_node_t *afl_spin_mcs_t;
+
+#define AFL_SPIN_MCS_INIT NULL
+
+static inline int afl_spin_mcs_init(afl_spin_mcs_t *spinlock)
+{
+    __atomic_store_n(spinlock, NULL, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline int afl_spin_mcs_lock(afl_spin_mcs_t *spinlock, afl_spin_mcs_node_t *node)
+{
+    afl_spin_mcs_node_t *prev;
+
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&node->locked, AFL_LOCKED, __ATOMIC_RELAXED);
+
+    prev = __atomic_exchange_n(spinlock, node, __ATOMIC_ACQ_REL);
+    if (__afl_likely(!prev))
+        return 0;
+
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+
+    while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE) != AFL_UNLOCKED)
+        __afl_pause;
 
     return 0;
 }
 
+static inline int afl_spin_mcs_unlock(afl_spin_mcs_t *spinlock, afl_spin_mcs_node_t *node)
+{
+    afl_spin_mcs_node_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+
+    if (__afl_likely(!next)) {
+        afl_spin_mcs_node_t *tail = node;
+        if (__atomic_compare_exchange_n(spinlock, &tail, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return 0;
+        while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)))
+            __afl_pause;
+    }
+
+    __atomic_store_n(&next->locked, AFL_UNLOCKED, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static inline int afl_spin_mcs_destroy(afl_spin_mcs_t *spinlock)
+{
+    return afl_spin_mcs_init(spinlock);
+}
+
 /*
- * Once
+ * Mutex
+ *
+ * The afl_*_pshared_* variants work on locks placed in memory shared between processes (MAP_SHARED):
+ * they use global futexes instead of FUTEX_PRIVATE_FLAG, and the owner variants record the kernel Thread ID,
+ * which is unique across processes, instead of the TLS pointer.
  */
-typedef __AFL_ALIGN uint32_t afl_once_t;
-
-#define AFL_SUCCESS 0x40000000 // Once init success, just return
+typedef __AFL_ALIGN uint32_t afl_mutex_t;
 
-#define AFL_ONCE_INIT 0
+#define AFL_MUTEX_INIT 0
 
-static inline int afl_once(afl_once_t *once, void (*init)(void))
+static inline int __afl_mutex_lock(afl_mutex_t *mutex, int private_flag)
 {
     uint32_t lock;
 
-    __atomic_load(once, &lock, __ATOMIC_RELAXED);
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
 
-    if (__afl_likely(lock & AFL_SUCCESS))
-        return 0;
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = AFL_UNLOCKED;
+        if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+            __afl_stats_acquired(mutex);
+            return 0;
+        }
+    }
 
-try_lock:
-    lock = AFL_UNLOCKED;
-    if (__atomic_compare_exchange_n(once, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
-        init();
+    __afl_stats_begin(start);
+
+    if (!(lock & AFL_HAVE_WAITERS))
+        lock = __atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+
+    while (lock != AFL_UNLOCKED) {
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAIT | private_flag, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
+        __afl_stats_futex_wait(mutex);
+        lock = __atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+    }
+
+    __afl_stats_contended(mutex, start, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_lock(mutex, FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_lock(mutex, 0);
+}
 
-        if (__atomic_exchange_n(once, AFL_SUCCESS, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS)
-            __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+static inline int afl_mutex_trylock(afl_mutex_t *mutex)
+{
+    uint32_t lock = AFL_UNLOCKED;
 
+    if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
         return 0;
     }
 
-    if (lock & AFL_SUCCESS)
+    return EBUSY;
+}
+
+/*
+ * Lock with an absolute CLOCK_MONOTONIC deadline.
+ * A waiter that times out makes one more exchange, so a wakeup it consumed is never lost:
+ * it either takes the released lock or leaves AFL_HAVE_WAITERS set for the current owner.
+ */
+static inline int afl_mutex_timedlock(afl_mutex_t *mutex, const struct timespec *abstime)
+{
+    uint32_t lock = AFL_UNLOCKED;
+
+    if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
         return 0;
+    }
 
-    lock = AFL_LOCKED;
-    if (__atomic_compare_exchange_n(once, &lock, AFL_LOCKED | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-        __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
 
-    if (!(lock & AFL_SUCCESS))
-        goto try_lock;
+    __afl_stats_begin(start);
+
+    lock = __atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+
+    while (lock != AFL_UNLOCKED) {
+        int ret = __afl_futex_wait_until(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, abstime);
+        __afl_stats_futex_wait(mutex);
+        lock = __atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (ret == -ETIMEDOUT && lock != AFL_UNLOCKED)
+            return ETIMEDOUT;
+    }
+
+    __afl_stats_contended(mutex, start, 0);
 
     return 0;
 }
 
+static inline int afl_mutex_reltimedlock(afl_mutex_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_mutex_timedlock(mutex, &abstime);
+}
+
+static inline int __afl_mutex_unlock(afl_mutex_t *mutex, int private_flag)
+{
+    uint32_t lock;
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(lock == AFL_UNLOCKED, "An attempt was made to unlock an unlocked mutex.");
+
+    __afl_stats_released(mutex);
+
+    if (__atomic_exchange_n(mutex, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS) {
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAKE | private_flag, 1, 0);
+        __afl_stats_futex_wake(mutex);
+    }
+
+    return 0;
+}
+
+static inline int afl_mutex_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_unlock(mutex, FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_unlock(mutex, 0);
+}
+
+static inline int __afl_mutex_owner_lock(afl_mutex_t *mutex, uint32_t tid, int private_flag)
+{
+    uint32_t lock;
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    if (__afl_likely(!lock && __atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
+        return 0;
+    }
+
+    __afl_stats_begin(start);
+
+try_lock:
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = __atomic_or_fetch(mutex, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (lock == AFL_HAVE_WAITERS
+            && __atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            goto acquired;
+    }
+
+    __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAIT | private_flag, lock, 0);
+    __afl_stats_futex_wait(mutex);
+    lock = AFL_UNLOCKED;
+    if (!__atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        goto try_lock;
+
+acquired:
+    __afl_stats_contended(mutex, start, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_owner_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_owner_lock(mutex, __afl_thread_pointer_tid(), FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_owner_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_owner_lock(mutex, __afl_gettid(), 0);
+}
+
+static inline int afl_mutex_owner_trylock(afl_mutex_t *mutex)
+{
+    uint32_t lock = AFL_UNLOCKED;
+    uint32_t tid  = __afl_thread_pointer_tid();
+
+    if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
+        return 0;
+    }
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    return EBUSY;
+}
+
+/*
+ * Lock with an absolute CLOCK_MONOTONIC deadline.
+ * After the timeout the waiter runs the try_lock step once more without sleeping,
+ * so it never leaves a released lock with parked waiters and no AFL_HAVE_WAITERS bit.
+ */
+static inline int afl_mutex_owner_timedlock(afl_mutex_t *mutex, const struct timespec *abstime)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_thread_pointer_tid();
+    int timedout = 0;
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    if (__afl_likely(!lock && __atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
+        return 0;
+    }
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __afl_stats_begin(start);
+
+try_lock:
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = __atomic_or_fetch(mutex, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (lock == AFL_HAVE_WAITERS
+            && __atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            goto acquired;
+    }
+
+    if (timedout)
+        return ETIMEDOUT;
+
+    if (__afl_futex_wait_until(mutex, lock, abstime) == -ETIMEDOUT)
+        timedout = 1;
+    __afl_stats_futex_wait(mutex);
+
+    lock = AFL_UNLOCKED;
+    if (!__atomic_compare_exchange_n(mutex, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        goto try_lock;
+
+acquired:
+    __afl_stats_contended(mutex, start, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_owner_reltimedlock(afl_mutex_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_mutex_owner_timedlock(mutex, &abstime);
+}
+
+static inline int __afl_mutex_owner_unlock(afl_mutex_t *mutex, uint32_t tid, int private_flag)
+{
+    uint32_t lock;
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
+        return EPERM;
+
+    __afl_stats_released(mutex);
+
+    if (__atomic_exchange_n(mutex, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS) {
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAKE | private_flag, 1, 0);
+        __afl_stats_futex_wake(mutex);
+    }
+
+    return 0;
+}
+
+static inline int afl_mutex_owner_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_owner_unlock(mutex, __afl_thread_pointer_tid(), FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_owner_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_owner_unlock(mutex, __afl_gettid(), 0);
+}
+
+static inline int __afl_mutex_pi_lock(afl_mutex_t *mutex, int private_flag)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_gettid();
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    if (lock || (!lock && !__atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_LOCK_PI | private_flag, 0, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_pi_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_pi_lock(mutex, FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_pi_lock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_pi_lock(mutex, 0);
+}
+
+static inline int afl_mutex_pi_trylock(afl_mutex_t *mutex)
+{
+    uint32_t lock = AFL_UNLOCKED;
+    uint32_t tid  = __afl_gettid();
+
+    if (__afl_likely(__atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+        return 0;
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    return EBUSY;
+}
+
+/*
+ * Lock with an absolute CLOCK_MONOTONIC deadline.
+ * FUTEX_LOCK_PI2 (Linux 5.14) takes a CLOCK_MONOTONIC timeout, so the deadline is passed as is.
+ * Older kernels return ENOSYS and FUTEX_LOCK_PI is used with the deadline moved to CLOCK_REALTIME.
+ */
+#ifndef FUTEX_LOCK_PI2
+#define FUTEX_LOCK_PI2 13
+#endif
+
+static inline int afl_mutex_pi_timedlock(afl_mutex_t *mutex, const struct timespec *abstime)
+{
+    int ret;
+    uint32_t lock;
+    uint32_t tid = __afl_gettid();
+    struct timespec monotonic, realtime;
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    if (__afl_likely(!lock && __atomic_compare_exchange_n(mutex, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+        return 0;
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    ret = __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_LOCK_PI2 | FUTEX_PRIVATE_FLAG, 0, (intptr_t) abstime);
+
+    if (__afl_unlikely(ret == -ENOSYS)) {
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        realtime.tv_sec += abstime->tv_sec - monotonic.tv_sec;
+        realtime.tv_nsec += abstime->tv_nsec - monotonic.tv_nsec;
+        if (realtime.tv_nsec < 0) {
+            realtime.tv_sec--;
+            realtime.tv_nsec += 1000000000;
+        } else if (realtime.tv_nsec >= 1000000000) {
+            realtime.tv_sec++;
+            realtime.tv_nsec -= 1000000000;
+        }
+        ret = __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_LOCK_PI | FUTEX_PRIVATE_FLAG, 0, (intptr_t) &realtime);
+    }
+
+    return -ret;
+}
+
+static inline int afl_mutex_pi_reltimedlock(afl_mutex_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_mutex_pi_timedlock(mutex, &abstime);
+}
+
+static inline int __afl_mutex_pi_unlock(afl_mutex_t *mutex, int private_flag)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_gettid();
+
+    __atomic_load(mutex, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
+        return EPERM;
+
+    if (!__atomic_compare_exchange_n(mutex, &tid, AFL_UNLOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_UNLOCK_PI | private_flag, 0, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_pi_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_pi_unlock(mutex, FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_mutex_pshared_pi_unlock(afl_mutex_t *mutex)
+{
+    return __afl_mutex_pi_unlock(mutex, 0);
+}
+
+static inline int afl_mutex_destroy(afl_mutex_t *mutex)
+{
+    __atomic_store_n(mutex, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Robust Mutex
+ *
+ * The lock word holds the kernel Thread ID of the owner and AFL_HAVE_WAITERS like afl_mutex_owner_lock,
+ * and a locked mutex is linked into the robust list of its owner thread (set_robust_list).
+ * When the owner dies the kernel walks that list, replaces the Thread ID with FUTEX_OWNER_DIED and wakes a waiter,
+ * which then gets the lock together with EOWNERDEAD.  The protected state must be repaired and marked with
+ * afl_mutex_robust_consistent before unlock, otherwise the mutex becomes permanently ENOTRECOVERABLE.
+ *
+ * There is only one robust list per thread and glibc registers its own for pthread robust mutexes,
+ * so afl entries are linked into that list.  The prev / next pair sits at the same distance from the lock word
+ * as __list in the 64-bit glibc pthread_mutex_t and uses the same doubly linked protocol, so glibc and the kernel
+ * walk both kinds of mutexes.  A thread without a list gets its own, a list head with a different futex_offset
+ * (32-bit glibc, other libcs) makes the robust functions return ENOTSUP.
+ *
+ * The kernel wakes the waiters of a dead owner with a shared futex wake, so robust mutexes always use shared futexes
+ * and work in memory shared between processes without a pshared variant.
+ */
+#define AFL_ROBUST_OWNER_DIED FUTEX_OWNER_DIED
+#define AFL_ROBUST_NOTRECOVERABLE AFL_TID_MASK // Thread ID that can't exist, never matches a dying thread
+
+typedef struct
+{
+    uint32_t lock;
+    uint32_t inconsistent;
+    uint32_t __reserved[4];
+    void *prev;
+    void *next;
+} __AFL_ALIGN afl_mutex_robust_t;
+
+#define AFL_MUTEX_ROBUST_INIT {0}
+
+typedef struct
+{
+    void *prev; // Written when the last entry is unlinked, like robust_prev in the glibc struct pthread
+    struct robust_list_head head;
+} __afl_robust_own_head_t;
+
+static inline struct robust_list_head **__afl_robust_cache(void)
+{
+    static __thread struct robust_list_head *head;
+    return &head;
+}
+
+static inline void __afl_robust_reset(void)
+{
+    *__afl_robust_cache() = NULL;
+}
+
+/*
+ * Returns the robust list head of the calling thread, NULL when its layout is not compatible.
+ * The child of fork has no robust list registered, so the cache is cleared like the Thread ID cache.
+ */
+static inline struct robust_list_head *__afl_robust_head(void)
+{
+    static __thread __afl_robust_own_head_t own;
+    static uint32_t atfork;
+    struct robust_list_head **cache = __afl_robust_cache();
+    struct robust_list_head *head   = NULL;
+    size_t length                   = 0;
+    long offset = (long) offsetof(afl_mutex_robust_t, lock) - (long) offsetof(afl_mutex_robust_t, next);
+
+    if (__afl_likely(*cache != NULL))
+        return *cache;
+
+    __afl_atfork(&atfork, __afl_robust_reset);
+
+    __afl_syscall(__NR_get_robust_list, 0, (intptr_t) &head, (intptr_t) &length, 0);
+
+    if (!head) {
+        own.head.list.next       = &own.head.list;
+        own.head.futex_offset    = offset;
+        own.head.list_op_pending = NULL;
+        if (__afl_syscall(__NR_set_robust_list, (intptr_t) &own.head, sizeof(own.head), 0, 0) < 0)
+            return NULL;
+        head = &own.head;
+    } else if (head->futex_offset != offset) {
+        return NULL;
+    }
+
+    *cache = head;
+
+    return head;
+}
+
+static inline void __afl_robust_enqueue(struct robust_list_head *head, afl_mutex_robust_t *mutex)
+{
+    void **first = (void **) ((uintptr_t) head->list.next & ~1UL);
+
+    first[-1]       = &mutex->next;
+    mutex->next     = head->list.next;
+    mutex->prev     = &head->list;
+    head->list.next = (struct robust_list *) &mutex->next;
+}
+
+static inline void __afl_robust_dequeue(afl_mutex_robust_t *mutex)
+{
+    void **next = (void **) ((uintptr_t) mutex->next & ~1UL);
+    void **prev = (void **) ((uintptr_t) mutex->prev & ~1UL);
+
+    next[-1]    = mutex->prev;
+    prev[0]     = mutex->next;
+    mutex->prev = NULL;
+    mutex->next = NULL;
+}
+
+static inline int afl_mutex_robust_init(afl_mutex_robust_t *mutex)
+{
+    mutex->inconsistent = 0;
+    mutex->prev         = NULL;
+    mutex->next         = NULL;
+    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/*
+ * list_op_pending covers the window between the lock word update and the list update,
+ * a thread that dies inside it still has the mutex released by the kernel.
+ */
+static inline int __afl_mutex_robust_acquired(struct robust_list_head *head, afl_mutex_robust_t *mutex, uint32_t lock)
+{
+    __afl_robust_enqueue(head, mutex);
+    __atomic_store_n(&head->list_op_pending, NULL, __ATOMIC_RELAXED);
+
+    if (__afl_unlikely(lock & AFL_ROBUST_OWNER_DIED)) {
+        mutex->inconsistent = 1;
+        return EOWNERDEAD;
+    }
+
+    return 0;
+}
+
+static inline int __afl_mutex_robust_lock(afl_mutex_robust_t *mutex, const struct timespec *abstime)
+{
+    uint32_t lock                 = AFL_UNLOCKED;
+    uint32_t tid                  = __afl_gettid();
+    struct robust_list_head *head = __afl_robust_head();
+    int ret;
+
+    if (__afl_unlikely(!head))
+        return ENOTSUP;
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __atomic_store_n(&head->list_op_pending, (struct robust_list *) &mutex->next, __ATOMIC_RELAXED);
+
+    if (__afl_likely(__atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
+        return __afl_mutex_robust_acquired(head, mutex, lock);
+    }
+
+    __afl_stats_begin(start);
+
+    for (;;) {
+        uint32_t owner = lock & AFL_TID_MASK;
+
+        if (__afl_unlikely(owner == AFL_ROBUST_NOTRECOVERABLE || owner == tid)) {
+            __afl_debug(owner == tid, "An attempt was made to lock already owned mutex.");
+            __atomic_store_n(&head->list_op_pending, NULL, __ATOMIC_RELAXED);
+            return owner == tid ? EDEADLOCK : ENOTRECOVERABLE;
+        }
+
+        /* Released or the owner died, other waiters may still sleep so AFL_HAVE_WAITERS is kept. */
+        if (!owner) {
+            if (__atomic_compare_exchange_n(
+                  &mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+                ))
+                break;
+            continue;
+        }
+
+        if (!(lock & AFL_HAVE_WAITERS)
+            && !__atomic_compare_exchange_n(
+              &mutex->lock, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+            ))
+            continue;
+
+        ret = __afl_syscall6(
+          __NR_futex, (intptr_t) &mutex->lock, FUTEX_WAIT_BITSET, lock | AFL_HAVE_WAITERS, (intptr_t) abstime, 0,
+          FUTEX_BITSET_MATCH_ANY
+        );
+        if (__afl_unlikely(ret < 0 && ret != -EAGAIN && ret != -EINTR)) {
+            __atomic_store_n(&head->list_op_pending, NULL, __ATOMIC_RELAXED);
+            return -ret;
+        }
+        __afl_stats_futex_wait(mutex);
+
+        __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+    }
+
+    __afl_stats_contended(mutex, start, 0);
+
+    return __afl_mutex_robust_acquired(head, mutex, lock);
+}
+
+static inline int afl_mutex_robust_lock(afl_mutex_robust_t *mutex)
+{
+    return __afl_mutex_robust_lock(mutex, NULL);
+}
+
+static inline int afl_mutex_robust_timedlock(afl_mutex_robust_t *mutex, const struct timespec *abstime)
+{
+    return __afl_mutex_robust_lock(mutex, abstime);
+}
+
+static inline int afl_mutex_robust_reltimedlock(afl_mutex_robust_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return __afl_mutex_robust_lock(mutex, &abstime);
+}
+
+static inline int afl_mutex_robust_trylock(afl_mutex_robust_t *mutex)
+{
+    uint32_t lock                 = AFL_UNLOCKED;
+    uint32_t tid                  = __afl_gettid();
+    struct robust_list_head *head = __afl_robust_head();
+
+    if (__afl_unlikely(!head))
+        return ENOTSUP;
+
+    __atomic_store_n(&head->list_op_pending, (struct robust_list *) &mutex->next, __ATOMIC_RELAXED);
+
+    do {
+        if (lock & AFL_TID_MASK) {
+            __atomic_store_n(&head->list_op_pending, NULL, __ATOMIC_RELAXED);
+            if ((lock & AFL_TID_MASK) == AFL_ROBUST_NOTRECOVERABLE)
+                return ENOTRECOVERABLE;
+            return (lock & AFL_TID_MASK) == tid ? EDEADLOCK : EBUSY;
+        }
+    } while (!__atomic_compare_exchange_n(
+      &mutex->lock, &lock, tid | (lock & AFL_HAVE_WAITERS), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+    ));
+
+    __afl_stats_acquired(mutex);
+
+    return __afl_mutex_robust_acquired(head, mutex, lock);
+}
+
+/*
+ * Marks the state protected by a mutex acquired with EOWNERDEAD as repaired.
+ */
+static inline int afl_mutex_robust_consistent(afl_mutex_robust_t *mutex)
+{
+    uint32_t lock;
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    if (__afl_unlikely((lock & AFL_TID_MASK) != __afl_gettid()))
+        return EPERM;
+
+    if (__afl_unlikely(!mutex->inconsistent))
+        return EINVAL;
+
+    mutex->inconsistent = 0;
+
+    return 0;
+}
+
+static inline int afl_mutex_robust_unlock(afl_mutex_robust_t *mutex)
+{
+    uint32_t lock;
+    uint32_t tid                  = __afl_gettid();
+    struct robust_list_head *head = __afl_robust_head();
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK) || !head))
+        return EPERM;
+
+    __afl_stats_released(mutex);
+
+    __atomic_store_n(&head->list_op_pending, (struct robust_list *) &mutex->next, __ATOMIC_RELAXED);
+    __afl_robust_dequeue(mutex);
+
+    if (__afl_unlikely(mutex->inconsistent)) {
+        mutex->inconsistent = 0;
+        __atomic_store_n(&mutex->lock, AFL_ROBUST_NOTRECOVERABLE, __ATOMIC_RELEASE);
+        __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAKE, INT32_MAX, 0);
+    } else if (__atomic_exchange_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS) {
+        __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAKE, 1, 0);
+        __afl_stats_futex_wake(mutex);
+    }
+
+    __atomic_store_n(&head->list_op_pending, NULL, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+static inline int afl_mutex_robust_destroy(afl_mutex_robust_t *mutex)
+{
+    return afl_mutex_robust_init(mutex);
+}
+
+/*
+ * Recursive Mutex
+ */
+typedef struct
+{
+    __attribute__((aligned(8))) uint32_t lock;
+    size_t count;
+} __AFL_ALIGN afl_mutex_recursive_t;
+
+static inline int afl_mutex_recursive_init(afl_mutex_recursive_t *mutex)
+{
+    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    mutex->count = 0;
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_lock(afl_mutex_recursive_t *mutex)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_thread_pointer_tid();
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    if (__afl_likely(
+          !lock && __atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+        ))
+        goto success;
+
+    if (__afl_likely(tid == (lock & AFL_TID_MASK))) {
+        __afl_debug(
+          mutex->count + 1 == 0,
+          "Recusive mutex counter overflow. "
+          "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+        );
+        if (__afl_unlikely(mutex->count + 1 == 0))
+            return EAGAIN;
+        mutex->count++;
+        return 0;
+    }
+
+try_lock:
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = __atomic_or_fetch(&mutex->lock, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (lock == AFL_HAVE_WAITERS
+            && __atomic_compare_exchange_n(
+              &mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+            ))
+            goto success;
+    }
+
+    __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock, 0);
+    lock = AFL_UNLOCKED;
+    if (!__atomic_compare_exchange_n(&mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        goto try_lock;
+
+success:
+    mutex->count = 1;
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_trylock(afl_mutex_recursive_t *mutex)
+{
+    uint32_t lock = AFL_UNLOCKED;
+    uint32_t tid  = __afl_thread_pointer_tid();
+
+    if (__afl_likely(__atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        mutex->count = 1;
+        return 0;
+    }
+
+    if (tid == (lock & AFL_TID_MASK)) {
+        __afl_debug(
+          mutex->count + 1 == 0,
+          "Recusive mutex counter overflow. "
+          "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+        );
+        if (__afl_unlikely(mutex->count + 1 == 0))
+            return EAGAIN;
+        mutex->count++;
+        return 0;
+    }
+
+    return EBUSY;
+}
+
+/*
+ * Lock with an absolute CLOCK_MONOTONIC deadline, see afl_mutex_owner_timedlock.
+ */
+static inline int afl_mutex_recursive_timedlock(afl_mutex_recursive_t *mutex, const struct timespec *abstime)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_thread_pointer_tid();
+    int timedout = 0;
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    if (__afl_likely(
+          !lock && __atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+        ))
+        goto success;
+
+    if (__afl_likely(tid == (lock & AFL_TID_MASK))) {
+        if (__afl_unlikely(mutex->count + 1 == 0))
+            return EAGAIN;
+        mutex->count++;
+        return 0;
+    }
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+try_lock:
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = __atomic_or_fetch(&mutex->lock, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (lock == AFL_HAVE_WAITERS
+            && __atomic_compare_exchange_n(
+              &mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+            ))
+            goto success;
+    }
+
+    if (timedout)
+        return ETIMEDOUT;
+
+    if (__afl_futex_wait_until(&mutex->lock, lock, abstime) == -ETIMEDOUT)
+        timedout = 1;
+
+    lock = AFL_UNLOCKED;
+    if (!__atomic_compare_exchange_n(&mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        goto try_lock;
+
+success:
+    mutex->count = 1;
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_reltimedlock(afl_mutex_recursive_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_mutex_recursive_timedlock(mutex, &abstime);
+}
+
+static inline int afl_mutex_recursive_unlock(afl_mutex_recursive_t *mutex)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_thread_pointer_tid();
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
+        return EPERM;
+
+    __afl_debug(mutex->count == 0, "An attempt was made to unlock an unlocked recursive mutex.");
+
+    if (--mutex->count == 0 && (__atomic_exchange_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_ACQUIRE) & AFL_HAVE_WAITERS))
+        __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_destroy(afl_mutex_recursive_t *mutex)
+{
+    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    mutex->count = 0;
+
+    return 0;
+}
+
+/*
+ * Recursive Priority Inheritance Mutex
+ *
+ * Works on afl_mutex_recursive_t with the kernel Thread ID in the lock word like afl_mutex_pi_lock,
+ * so a contended lock goes through FUTEX_LOCK_PI and boosts the owner.
+ * Only the first lock and the last unlock touch the lock word, nested calls only count.
+ */
+static inline int __afl_mutex_recursive_pi_owned(afl_mutex_recursive_t *mutex, uint32_t tid)
+{
+    return tid == (__atomic_load_n(&mutex->lock, __ATOMIC_RELAXED) & AFL_TID_MASK);
+}
+
+static inline int __afl_mutex_recursive_pi_nested(afl_mutex_recursive_t *mutex)
+{
+    __afl_debug(
+      mutex->count + 1 == 0,
+      "Recusive mutex counter overflow. "
+      "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+    );
+    if (__afl_unlikely(mutex->count + 1 == 0))
+        return EAGAIN;
+    mutex->count++;
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_pi_lock(afl_mutex_recursive_t *mutex)
+{
+    if (__afl_mutex_recursive_pi_owned(mutex, __afl_gettid()))
+        return __afl_mutex_recursive_pi_nested(mutex);
+
+    __afl_mutex_pi_lock(&mutex->lock, FUTEX_PRIVATE_FLAG);
+    mutex->count = 1;
+
+    return 0;
+}
+
+static inline int afl_mutex_recursive_pi_trylock(afl_mutex_recursive_t *mutex)
+{
+    int ret;
+
+    if (__afl_mutex_recursive_pi_owned(mutex, __afl_gettid()))
+        return __afl_mutex_recursive_pi_nested(mutex);
+
+    ret = afl_mutex_pi_trylock(&mutex->lock);
+    if (__afl_likely(!ret))
+        mutex->count = 1;
+
+    return ret;
+}
+
+static inline int afl_mutex_recursive_pi_timedlock(afl_mutex_recursive_t *mutex, const struct timespec *abstime)
+{
+    int ret;
+
+    if (__afl_mutex_recursive_pi_owned(mutex, __afl_gettid()))
+        return __afl_mutex_recursive_pi_nested(mutex);
+
+    ret = afl_mutex_pi_timedlock(&mutex->lock, abstime);
+    if (__afl_likely(!ret))
+        mutex->count = 1;
+
+    return ret;
+}
+
+static inline int afl_mutex_recursive_pi_reltimedlock(afl_mutex_recursive_t *mutex, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_mutex_recursive_pi_timedlock(mutex, &abstime);
+}
+
+static inline int afl_mutex_recursive_pi_unlock(afl_mutex_recursive_t *mutex)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_gettid();
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
+        return EPERM;
+
+    __afl_debug(mutex->count == 0, "An attempt was made to unlock an unlocked recursive mutex.");
+
+    if (--mutex->count == 0)
+        return __afl_mutex_pi_unlock(&mutex->lock, FUTEX_PRIVATE_FLAG);
+
+    return 0;
+}
+
+/*
+ * Once
+ *
+ * The init function runs while the word is AFL_LOCKED and AFL_SUCCESS is stored when it returns.
+ * AFL_HAVE_WAITERS may already be set before init starts, when afl_wait_any waits for the once to complete.
+ *
+ * afl_once_pshared works on an afl_once_t placed in memory shared between processes.
+ */
+typedef __AFL_ALIGN uint32_t afl_once_t;
+
+#define AFL_SUCCESS 0x40000000 // Once init success, just return
+
+#define AFL_ONCE_INIT 0
+
+static inline int __afl_once(afl_once_t *once, void (*init)(void), int private_flag)
+{
+    uint32_t lock;
+
+    __atomic_load(once, &lock, __ATOMIC_ACQUIRE);
+
+    if (__afl_likely(lock & AFL_SUCCESS))
+        return 0;
+
+try_lock:
+    lock &= AFL_HAVE_WAITERS;
+    if (__atomic_compare_exchange_n(once, &lock, AFL_LOCKED | lock, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        init();
+
+        if (__atomic_exchange_n(once, AFL_SUCCESS, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS)
+            __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAKE | private_flag, INT32_MAX, 0);
+
+        return 0;
+    }
+
+    if (lock & AFL_SUCCESS)
+        return 0;
+
+    if (!(lock & AFL_LOCKED))
+        goto try_lock;
+
+    if ((lock & AFL_HAVE_WAITERS)
+        || __atomic_compare_exchange_n(once, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAIT | private_flag, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
+
+    __atomic_load(once, &lock, __ATOMIC_ACQUIRE);
+
+    if (!(lock & AFL_SUCCESS))
+        goto try_lock;
+
+    return 0;
+}
+
+static inline int afl_once(afl_once_t *once, void (*init)(void))
+{
+    return __afl_once(once, init, FUTEX_PRIVATE_FLAG);
+}
+
+static inline int afl_once_pshared(afl_once_t *once, void (*init)(void))
+{
+    return __afl_once(once, init, 0);
+}
+
+/*
+ * Reader/Writer Lock
+ *
+ * Slim reader/writer lock in a single 32-bit futex word, so it fits in a pointer-sized word like Windows SRWLOCK.
+ *
+ * Bits 0-28 hold the number of readers, AFL_RW_WRITER is set while a writer owns the lock,
+ * AFL_RW_WRITER_WAITING is set while a writer waits and AFL_HAVE_WAITERS is set while any thread sleeps in futex.
+ *
+ * Writer preference: new readers do not enter while AFL_RW_WRITER_WAITING is set.
+ * Unlock wakes all sleepers when AFL_HAVE_WAITERS is set, every woken thread re-checks the lock word
+ * and sets the wait bits again before going back to sleep, so no wakeup is lost.
+ */
+typedef __AFL_ALIGN uint32_t afl_rwlock_t;
+
+#define AFL_RWLOCK_INIT 0
+
+#define AFL_RW_WRITER 0x40000000         // Writer owns the lock
+#define AFL_RW_WRITER_WAITING 0x20000000 // Writer is waiting, block new readers
+#define AFL_RW_READERS_MASK 0x1FFFFFFF   // Number of readers bit mask
+
+static inline int afl_rwlock_init(afl_rwlock_t *rwlock)
+{
+    __atomic_store_n(rwlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline int afl_rwlock_shared_trylock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock;
+
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+
+    do {
+        if (lock & (AFL_RW_WRITER | AFL_RW_WRITER_WAITING))
+            return EBUSY;
+        if (__afl_unlikely((lock & AFL_RW_READERS_MASK) == AFL_RW_READERS_MASK))
+            return EAGAIN;
+    } while (!__atomic_compare_exchange_n(rwlock, &lock, lock + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return 0;
+}
+
+static inline int afl_rwlock_shared_lock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock = AFL_UNLOCKED;
+
+    if (__afl_likely(__atomic_compare_exchange_n(rwlock, &lock, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+        return 0;
+
+loop:
+    if (!(lock & (AFL_RW_WRITER | AFL_RW_WRITER_WAITING))) {
+        __afl_debug(
+          (lock & AFL_RW_READERS_MASK) == AFL_RW_READERS_MASK,
+          "Reader/writer lock readers counter overflow. "
+          "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+        );
+        if (__afl_unlikely((lock & AFL_RW_READERS_MASK) == AFL_RW_READERS_MASK))
+            return EAGAIN;
+        if (__atomic_compare_exchange_n(rwlock, &lock, lock + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return 0;
+        goto loop;
+    }
+
+    if (!(lock & AFL_HAVE_WAITERS)
+        && !__atomic_compare_exchange_n(rwlock, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        goto loop;
+
+    __afl_syscall(__NR_futex, (intptr_t) rwlock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock | AFL_HAVE_WAITERS, 0);
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+    goto loop;
+}
+
+static inline int afl_rwlock_shared_unlock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock;
+
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(
+      !(lock & AFL_RW_READERS_MASK), "An attempt was made to unlock a reader/writer lock not locked in shared mode."
+    );
+
+    lock = __atomic_sub_fetch(rwlock, 1, __ATOMIC_RELEASE);
+
+    while (!(lock & AFL_RW_READERS_MASK) && (lock & AFL_HAVE_WAITERS)) {
+        if (__atomic_compare_exchange_n(
+              rwlock, &lock, lock & ~AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+            )) {
+            __afl_syscall(__NR_futex, (intptr_t) rwlock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static inline int afl_rwlock_exclusive_trylock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock;
+
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+
+    do {
+        if (lock & (AFL_RW_WRITER | AFL_RW_READERS_MASK))
+            return EBUSY;
+    } while (!__atomic_compare_exchange_n(
+      rwlock, &lock, AFL_RW_WRITER | (lock & AFL_HAVE_WAITERS), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+    ));
+
+    return 0;
+}
+
+static inline int afl_rwlock_exclusive_lock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock = AFL_UNLOCKED;
+
+    if (__afl_likely(__atomic_compare_exchange_n(rwlock, &lock, AFL_RW_WRITER, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+        return 0;
+
+loop:
+    if (!(lock & (AFL_RW_WRITER | AFL_RW_READERS_MASK))) {
+        if (__atomic_compare_exchange_n(
+              rwlock, &lock, AFL_RW_WRITER | (lock & AFL_HAVE_WAITERS), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+            ))
+            return 0;
+        goto loop;
+    }
+
+    if ((lock & (AFL_RW_WRITER_WAITING | AFL_HAVE_WAITERS)) != (AFL_RW_WRITER_WAITING | AFL_HAVE_WAITERS)
+        && !__atomic_compare_exchange_n(
+          rwlock, &lock, lock | AFL_RW_WRITER_WAITING | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+        ))
+        goto loop;
+
+    __afl_syscall(
+      __NR_futex, (intptr_t) rwlock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock | AFL_RW_WRITER_WAITING | AFL_HAVE_WAITERS, 0
+    );
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+    goto loop;
+}
+
+static inline int afl_rwlock_exclusive_unlock(afl_rwlock_t *rwlock)
+{
+    uint32_t lock;
+
+    __atomic_load(rwlock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(
+      !(lock & AFL_RW_WRITER), "An attempt was made to unlock a reader/writer lock not locked in exclusive mode."
+    );
+
+    if (__atomic_fetch_and(rwlock, AFL_RW_WRITER_WAITING, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS)
+        __afl_syscall(__NR_futex, (intptr_t) rwlock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+    return 0;
+}
+
+static inline int afl_rwlock_destroy(afl_rwlock_t *rwlock)
+{
+    __atomic_store_n(rwlock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Condition Variable
+ *
+ * Waiters sleep on the sequence counter, signal and broadcast increment it.
+ * The waiters counter lets signal and broadcast skip the syscall when nobody waits.
+ *
+ * Broadcast wakes one waiter and requeues the rest onto the afl_mutex_t futex word with FUTEX_CMP_REQUEUE
+ * (wait morphing), so the waiters are woken one by one by afl_mutex_unlock instead of all at once.
+ * For this reason a woken waiter always relocks the mutex with AFL_HAVE_WAITERS set.
+ *
+ * Timed wait takes an absolute CLOCK_MONOTONIC deadline, an invalid one returns EINVAL with the mutex still held.
+ */
+typedef struct
+{
+    uint32_t seq;
+    uint32_t waiters;
+    afl_mutex_t *mutex;
+} __AFL_ALIGN afl_cond_t;
+
+#define AFL_COND_INIT \
+    {                 \
+        0, 0, NULL    \
+    }
+
+static inline int afl_cond_init(afl_cond_t *cond)
+{
+    __atomic_store_n(&cond->seq, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cond->waiters, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cond->mutex, NULL, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline void __afl_cond_relock(afl_mutex_t *mutex)
+{
+    while (__atomic_exchange_n(mutex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE) != AFL_UNLOCKED)
+        __afl_syscall(__NR_futex, (intptr_t) mutex, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
+}
+
+static inline int afl_cond_timedwait(afl_cond_t *cond, afl_mutex_t *mutex, const struct timespec *abstime)
+{
+    int ret = 0;
+    uint32_t seq;
+
+    __afl_debug(
+      cond->mutex && cond->mutex != mutex, "An attempt was made to wait on a condition variable with another mutex."
+    );
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __atomic_store_n(&cond->mutex, mutex, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cond->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_load(&cond->seq, &seq, __ATOMIC_SEQ_CST);
+
+    afl_mutex_unlock(mutex);
+
+    /* A waiter requeued onto the mutex by broadcast can time out there after its wake, seq tells them apart. */
+    if (__afl_futex_wait_until(&cond->seq, seq, abstime) == -ETIMEDOUT
+        && __atomic_load_n(&cond->seq, __ATOMIC_RELAXED) == seq)
+        ret = ETIMEDOUT;
+
+    __atomic_sub_fetch(&cond->waiters, 1, __ATOMIC_RELAXED);
+
+    __afl_cond_relock(mutex);
+
+    return ret;
+}
+
+static inline int afl_cond_wait(afl_cond_t *cond, afl_mutex_t *mutex)
+{
+    return afl_cond_timedwait(cond, mutex, NULL);
+}
+
+static inline int afl_cond_signal(afl_cond_t *cond)
+{
+    __atomic_add_fetch(&cond->seq, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST))
+        __afl_syscall(__NR_futex, (intptr_t) &cond->seq, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+
+    return 0;
+}
+
+static inline int afl_cond_broadcast(afl_cond_t *cond)
+{
+    afl_mutex_t *mutex;
+    uint32_t seq = __atomic_add_fetch(&cond->seq, 1, __ATOMIC_SEQ_CST);
+
+    if (!__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST))
+        return 0;
+
+    __atomic_load(&cond->mutex, &mutex, __ATOMIC_RELAXED);
+
+    if (__afl_unlikely(
+          !mutex
+          || __afl_syscall6(
+               __NR_futex, (intptr_t) &cond->seq, FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG, 1, INT32_MAX,
+               (intptr_t) mutex, seq
+             ) < 0
+        ))
+        __afl_syscall(__NR_futex, (intptr_t) &cond->seq, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+    return 0;
+}
+
+static inline int afl_cond_destroy(afl_cond_t *cond)
+{
+    __afl_debug(
+      __atomic_load_n(&cond->waiters, __ATOMIC_RELAXED),
+      "An attempt was made to destroy a condition variable with waiters."
+    );
+    return afl_cond_init(cond);
+}
+
+/*
+ * Priority Inheritance Condition Variable
+ *
+ * Waits on an afl_cond_t with a mutex locked by afl_mutex_pi_lock. The waiter sleeps on the sequence counter
+ * with FUTEX_WAIT_REQUEUE_PI, signal and broadcast move it to the PI futex of the mutex with FUTEX_CMP_REQUEUE_PI:
+ * the kernel takes the mutex on behalf of the woken waiter or queues it on the rt_mutex, where it boosts the owner
+ * like FUTEX_LOCK_PI. A waiter that returns 0 from the syscall already owns the mutex,
+ * after a timeout or a sequence change it relocks with afl_mutex_pi_lock.
+ *
+ * The kernel rejects FUTEX_WAKE on a futex with requeue-PI waiters, so a condition variable waited on
+ * with afl_cond_pi_* must be signaled with afl_cond_pi_* too.
+ */
+static inline int afl_cond_pi_timedwait(afl_cond_t *cond, afl_mutex_t *mutex, const struct timespec *abstime)
+{
+    int ret;
+    uint32_t seq;
+
+    __afl_debug(
+      cond->mutex && cond->mutex != mutex, "An attempt was made to wait on a condition variable with another mutex."
+    );
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __atomic_store_n(&cond->mutex, mutex, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cond->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_load(&cond->seq, &seq, __ATOMIC_SEQ_CST);
+
+    afl_mutex_pi_unlock(mutex);
+
+    ret = __afl_syscall6(
+      __NR_futex, (intptr_t) &cond->seq, FUTEX_WAIT_REQUEUE_PI | FUTEX_PRIVATE_FLAG, seq, (intptr_t) abstime,
+      (intptr_t) mutex, 0
+    );
+
+    __atomic_sub_fetch(&cond->waiters, 1, __ATOMIC_RELAXED);
+
+    if (__afl_likely(ret >= 0))
+        return 0;
+
+    afl_mutex_pi_lock(mutex);
+
+    return ret == -ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+static inline int afl_cond_pi_wait(afl_cond_t *cond, afl_mutex_t *mutex)
+{
+    return afl_cond_pi_timedwait(cond, mutex, NULL);
+}
+
+/*
+ * FUTEX_CMP_REQUEUE_PI always wakes or requeues the first waiter and requeues up to `requeue` more.
+ */
+static inline int __afl_cond_pi_requeue(afl_cond_t *cond, int32_t requeue)
+{
+    afl_mutex_t *mutex;
+    uint32_t seq = __atomic_add_fetch(&cond->seq, 1, __ATOMIC_SEQ_CST);
+
+    if (!__atomic_load_n(&cond->waiters, __ATOMIC_SEQ_CST))
+        return 0;
+
+    __atomic_load(&cond->mutex, &mutex, __ATOMIC_RELAXED);
+
+    if (__afl_unlikely(!mutex))
+        return 0;
+
+    /* Another signal changed the sequence after the increment, requeue against the new value. */
+    while (__afl_syscall6(
+             __NR_futex, (intptr_t) &cond->seq, FUTEX_CMP_REQUEUE_PI | FUTEX_PRIVATE_FLAG, 1, requeue,
+             (intptr_t) mutex, seq
+           )
+           == -EAGAIN)
+        __atomic_load(&cond->seq, &seq, __ATOMIC_SEQ_CST);
+
+    return 0;
+}
+
+static inline int afl_cond_pi_signal(afl_cond_t *cond)
+{
+    return __afl_cond_pi_requeue(cond, 0);
+}
+
+static inline int afl_cond_pi_broadcast(afl_cond_t *cond)
+{
+    return __afl_cond_pi_requeue(cond, INT32_MAX);
+}
+
+/*
+ * Adaptive Mutex
+ *
+ * Spin-then-park mutex. The lock word records the owner like afl_mutex_owner_lock.
+ * On contention the waiter spins on the lock word inside a spin budget and parks in futex
+ * when the budget is exhausted, other waiters are already parked or the machine has one CPU.
+ * User space cannot see whether the owner is on a CPU, so an owner that holds the lock longer than the budget
+ * is treated as descheduled or blocked.
+ *
+ * The budget is AFL_ADAPTIVE_SPIN_BUDGET_NS converted to __afl_pause iterations by a one-time calibration.
+ * Every lock learns its spin count from recent acquisitions like glibc PTHREAD_MUTEX_ADAPTIVE_NP:
+ * a waiter spins at most 2 * spins + 10 iterations and moves spins 1/8 of the way to the iterations it needed.
+ */
+typedef struct
+{
+    __attribute__((aligned(8))) uint32_t lock;
+    uint32_t spins;
+} __AFL_ALIGN afl_mutex_adaptive_t;
+
+#define AFL_MUTEX_ADAPTIVE_INIT \
+    {                           \
+        0, 0                    \
+    }
+
+#define AFL_ADAPTIVE_SPIN_BUDGET_NS 10000 // About the cost of a futex wait and wake with two context switches
+#define AFL_ADAPTIVE_CALIBRATE_PAUSES 1000
+#define AFL_ADAPTIVE_MAX_SPINS 0xFFFF
+
+static inline uint32_t __afl_adaptive_max_spins(void)
+{
+    static uint32_t max_spins = UINT32_MAX;
+    struct timespec start, stop;
+    uint64_t duration;
+    uint32_t spins;
+
+    spins = __atomic_load_n(&max_spins, __ATOMIC_RELAXED);
+    if (__afl_likely(spins != UINT32_MAX))
+        return spins;
+
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        spins = 0;
+        goto done;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < AFL_ADAPTIVE_CALIBRATE_PAUSES; i++)
+        __afl_pause;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    duration = (stop.tv_sec - start.tv_sec) * UINT64_C(1000000000) + stop.tv_nsec - start.tv_nsec;
+    if (!duration)
+        duration = 1;
+
+    spins = (uint64_t) AFL_ADAPTIVE_SPIN_BUDGET_NS * AFL_ADAPTIVE_CALIBRATE_PAUSES / duration;
+    if (spins > AFL_ADAPTIVE_MAX_SPINS)
+        spins = AFL_ADAPTIVE_MAX_SPINS;
+
+done:
+    __atomic_store_n(&max_spins, spins, __ATOMIC_RELAXED);
+    return spins;
+}
+
+static inline int afl_mutex_adaptive_init(afl_mutex_adaptive_t *mutex)
+{
+    __atomic_store_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    __atomic_store_n(&mutex->spins, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static inline int afl_mutex_adaptive_lock(afl_mutex_adaptive_t *mutex)
+{
+    uint32_t lock = AFL_UNLOCKED;
+    uint32_t tid  = __afl_thread_pointer_tid();
+    uint32_t spins, max_spins, count;
+
+    if (__afl_likely(__atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        __afl_stats_acquired(mutex);
+        return 0;
+    }
+
+    __afl_debug(tid == (lock & AFL_TID_MASK), "An attempt was made to lock already owned mutex.");
+
+    if (__afl_unlikely(tid == (lock & AFL_TID_MASK)))
+        return EDEADLOCK;
+
+    __afl_stats_begin(start);
+    count = 0;
+
+    if (lock & AFL_HAVE_WAITERS)
+        goto try_lock;
+
+    spins     = __atomic_load_n(&mutex->spins, __ATOMIC_RELAXED);
+    max_spins = __afl_adaptive_max_spins();
+    if (max_spins > spins * 2 + 10)
+        max_spins = spins * 2 + 10;
+
+    for (count = 0; count < max_spins; count++) {
+        __afl_pause;
+        __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+        if (lock & AFL_HAVE_WAITERS)
+            break;
+        if (lock == AFL_UNLOCKED
+            && __atomic_compare_exchange_n(&mutex->lock, &lock, tid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&mutex->spins, spins + ((int32_t) (count - spins)) / 8, __ATOMIC_RELAXED);
+            goto acquired;
+        }
+    }
+
+    __atomic_store_n(&mutex->spins, spins + ((int32_t) (count - spins)) / 8, __ATOMIC_RELAXED);
+
+try_lock:
+    if (!(lock & AFL_HAVE_WAITERS)) {
+        lock = __atomic_or_fetch(&mutex->lock, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        if (lock == AFL_HAVE_WAITERS
+            && __atomic_compare_exchange_n(
+              &mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+            ))
+            goto acquired;
+    }
+
+    __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock, 0);
+    __afl_stats_futex_wait(mutex);
+    lock = AFL_UNLOCKED;
+    if (!__atomic_compare_exchange_n(&mutex->lock, &lock, tid | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        goto try_lock;
+
+acquired:
+    __afl_stats_contended(mutex, start, count);
+
+    return 0;
+}
+
+static inline int afl_mutex_adaptive_unlock(afl_mutex_adaptive_t *mutex)
+{
+    uint32_t lock;
+    uint32_t tid = __afl_thread_pointer_tid();
+
+    __atomic_load(&mutex->lock, &lock, __ATOMIC_RELAXED);
+
+    __afl_debug(tid != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+    if (__afl_unlikely(tid != (lock & AFL_TID_MASK)))
+        return EPERM;
+
+    __afl_stats_released(mutex);
+
+    if (__atomic_exchange_n(&mutex->lock, AFL_UNLOCKED, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS) {
+        __afl_syscall(__NR_futex, (intptr_t) &mutex->lock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+        __afl_stats_futex_wake(mutex);
+    }
+
+    return 0;
+}
+
+static inline int afl_mutex_adaptive_destroy(afl_mutex_adaptive_t *mutex)
+{
+    return afl_mutex_adaptive_init(mutex);
+}
+
+/*
+ * Cohort Lock
+ *
+ * NUMA-aware lock built from a global afl_mutex_t and one local afl_mutex_t per node.
+ * A thread takes the lock of its node and then the global lock, unless its node already holds it.
+ * On unlock the global lock stays with the node while threads of the same node wait for the local lock,
+ * up to AFL_COHORT_BATCH handoffs, so the protected data stays in the caches of one socket.
+ *
+ * The waiting counter is only touched in the local slow path, so the uncontended cost is two mutexes.
+ * A counted waiter never gives up, which makes it safe to keep the global lock for it.
+ * The global afl_mutex_t has no owner, so it can be released by another thread of the node.
+ *
+ * afl_cohort_lock uses the node of the calling CPU, afl_cohort_lock_node takes the node from the caller,
+ * which splits a single-node machine into simulated nodes.  Node numbers wrap at AFL_COHORT_MAX_NODES.
+ */
+#ifndef AFL_COHORT_MAX_NODES
+#define AFL_COHORT_MAX_NODES 8
+#endif
+
+#ifndef AFL_COHORT_BATCH
+#define AFL_COHORT_BATCH 64
+#endif
+
+#define AFL_NUMA_NODE_REFRESH 256 // Calls between two getcpu, threads rarely move across nodes
+
+typedef struct
+{
+    afl_mutex_t lock;
+    uint32_t waiting; // Threads waiting in the local slow path
+    uint32_t global;  // This node holds the global lock
+    uint32_t batch;   // Local handoffs since the global lock was taken
+} __afl_cohort_node_t;
+
+typedef struct
+{
+    afl_mutex_t global;
+    uint32_t node; // Node of the current owner
+    __afl_cohort_node_t nodes[AFL_COHORT_MAX_NODES];
+} afl_cohort_t;
+
+#define AFL_COHORT_INIT {0}
+
+/*
+ * NUMA node of the calling thread, read with getcpu and cached in TLS.
+ */
+static inline uint32_t afl_numa_node(void)
+{
+    static __thread uint32_t node, calls;
+
+    if (__afl_unlikely(!(calls++ % AFL_NUMA_NODE_REFRESH))) {
+        uint32_t cpu;
+        __afl_syscall(__NR_getcpu, (intptr_t) &cpu, (intptr_t) &node, 0, 0);
+    }
+
+    return node;
+}
+
+static inline int afl_cohort_init(afl_cohort_t *cohort)
+{
+    for (uint32_t i = 0; i < AFL_COHORT_MAX_NODES; i++) {
+        cohort->nodes[i].waiting = 0;
+        cohort->nodes[i].global  = 0;
+        cohort->nodes[i].batch   = 0;
+        afl_mutex_destroy(&cohort->nodes[i].lock);
+    }
+    cohort->node = 0;
+
+    return afl_mutex_destroy(&cohort->global);
+}
+
+static inline int afl_cohort_lock_node(afl_cohort_t *cohort, uint32_t node)
+{
+    __afl_cohort_node_t *local;
+
+    node %= AFL_COHORT_MAX_NODES;
+    local = &cohort->nodes[node];
+
+    if (__afl_unlikely(afl_mutex_trylock(&local->lock))) {
+        __atomic_add_fetch(&local->waiting, 1, __ATOMIC_RELAXED);
+        afl_mutex_lock(&local->lock);
+        __atomic_sub_fetch(&local->waiting, 1, __ATOMIC_RELAXED);
+    }
+
+    if (!local->global) {
+        afl_mutex_lock(&cohort->global);
+        local->global = 1;
+        local->batch  = 0;
+    }
+
+    cohort->node = node;
+
+    return 0;
+}
+
+static inline int afl_cohort_lock(afl_cohort_t *cohort)
+{
+    return afl_cohort_lock_node(cohort, afl_numa_node());
+}
+
+static inline int afl_cohort_unlock(afl_cohort_t *cohort)
+{
+    __afl_cohort_node_t *local = &cohort->nodes[cohort->node];
+
+    if (!__atomic_load_n(&local->waiting, __ATOMIC_RELAXED) || ++local->batch >= AFL_COHORT_BATCH) {
+        local->global = 0;
+        afl_mutex_unlock(&cohort->global);
+    }
+
+    return afl_mutex_unlock(&local->lock);
+}
+
+static inline int afl_cohort_destroy(afl_cohort_t *cohort)
+{
+    return afl_cohort_init(cohort);
+}
+
+/*
+ * Restartable Sequences and Per-CPU Locks
+ *
+ * A restartable sequence (rseq) is a block of instructions the kernel aborts when the thread is preempted,
+ * migrated or signaled before the final commit store, so a compare and store on per-CPU data is exclusive
+ * on that CPU without an atomic read-modify-write instruction.
+ *
+ * glibc 2.35 registers a struct rseq for every thread and publishes it with __rseq_offset / __rseq_size,
+ * a second registration fails with EBUSY.  afl uses the glibc area when there is one and otherwise
+ * registers its own TLS area.  The sequences are written for x86_64, other architectures and -DAFL_NO_RSEQ
+ * use the sharded fallback below.
+ *
+ * afl_percpu_t has one lock word per configured CPU.  With rseq a thread takes the word of its current CPU
+ * with a restartable compare and store and releases it with a plain store.  The word stays taken when the holder
+ * is preempted or migrates, another thread of that CPU then spins and yields until it is released.
+ * The fallback uses the same words as afl_spinlock_t shards picked by a cached getcpu, which costs an atomic
+ * per acquisition but keeps the threads of different CPUs on different cache lines.
+ * The mode is chosen by afl_percpu_init in the calling thread, it assumes that every thread has rseq
+ * when the first one has it, as is the case with glibc and the kernel.
+ */
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__has_include) && !defined(AFL_NO_RSEQ)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define __AFL_RSEQ_GLIBC 1
+#define AFL_HAVE_RSEQ 1
+#elif __has_include(<linux/rseq.h>)
+#include <linux/rseq.h>
+#define AFL_HAVE_RSEQ 1
+#endif
+#endif
+
+#ifndef AFL_HAVE_RSEQ
+#define AFL_HAVE_RSEQ 0
+#endif
+
+#ifndef RSEQ_SIG
+#define RSEQ_SIG 0x53053053
+#endif
+
+#define AFL_PERCPU_SPINS 64       // Spins on a taken per-CPU word before yielding
+#define AFL_PERCPU_CPU_REFRESH 64 // Calls between two getcpu in the sharded fallback
+
+#if AFL_HAVE_RSEQ
+/*
+ * Returns the rseq area of the calling thread, NULL when rseq is not available.
+ */
+static inline struct rseq *__afl_rseq_area(void)
+{
+    static __thread struct rseq own __attribute__((aligned(32)));
+    static __thread struct rseq *area;
+    static __thread int failed;
+
+    if (__afl_likely(area != NULL))
+        return area;
+
+    if (failed)
+        return NULL;
+
+#ifdef __AFL_RSEQ_GLIBC
+    if (__rseq_size) {
+        uintptr_t tp;
+        __afl_thread_pointer(tp);
+        area = (struct rseq *) (tp + __rseq_offset);
+    }
+#endif
+
+    if (!area) {
+        own.cpu_id = RSEQ_CPU_ID_UNINITIALIZED;
+        if (!__afl_syscall(__NR_rseq, (intptr_t) &own, sizeof(own), 0, RSEQ_SIG))
+            area = &own;
+    }
+
+    if (!area || (int32_t) __atomic_load_n(&area->cpu_id, __ATOMIC_RELAXED) < 0) {
+        area   = NULL;
+        failed = 1;
+    }
+
+    return area;
+}
+
+/*
+ * Stores newv to *v if *v is expect and the thread still runs on cpu.
+ * Returns 0 on commit, 1 when *v differs and -1 when the kernel aborted the sequence.
+ * The struct rseq_cs descriptor and the signed abort handler live in their own sections, like in librseq.
+ */
+static inline int __afl_rseq_cmpeqv_storev(struct rseq *rs, uint32_t *v, uint32_t expect, uint32_t newv, uint32_t cpu)
+{
+    __asm__ __volatile__ goto(
+      ".pushsection __rseq_cs, \"aw\"\n\t"
+      ".balign 32\n\t"
+      "3:\n\t"
+      ".long 0x0, 0x0\n\t"
+      ".quad 1f, (2f - 1f), 4f\n\t"
+      ".popsection\n\t"
+      "leaq 3b(%%rip), %%rax\n\t"
+      "movq %%rax, %[rseq_cs]\n\t"
+      "1:\n\t"
+      "cmpl %[cpu], %[cpu_id]\n\t"
+      "jnz 4f\n\t"
+      "cmpl %[expect], %[v]\n\t"
+      "jnz %l[cmpfail]\n\t"
+      "movl %[newv], %[v]\n\t"
+      "2:\n\t"
+      ".pushsection __rseq_failure, \"ax\"\n\t"
+      ".byte 0x0f, 0xb9, 0x3d\n\t"
+      ".long 0x53053053\n\t"
+      "4:\n\t"
+      "jmp %l[abort]\n\t"
+      ".popsection\n\t"
+      :
+      : [cpu] "r"(cpu), [cpu_id] "m"(rs->cpu_id), [rseq_cs] "m"(rs->rseq_cs), [v] "m"(*v), [expect] "r"(expect),
+        [newv] "r"(newv)
+      : "memory", "cc", "rax"
+      : abort, cmpfail
+    );
+
+    return 0;
+abort:
+    return -1;
+cmpfail:
+    return 1;
+}
+#else
+struct rseq;
+
+static inline struct rseq *__afl_rseq_area(void)
+{
+    return NULL;
+}
+#endif
+
+/*
+ * Registers rseq for the calling thread, ENOSYS when it is not available.
+ */
+static inline int afl_rseq_register(void)
+{
+    return __afl_rseq_area() ? 0 : ENOSYS;
+}
+
+/*
+ * CPU the calling thread runs on, read from the rseq area without a system call when possible.
+ */
+static inline uint32_t afl_rseq_cpu(void)
+{
+    uint32_t cpu = 0;
+
+#if AFL_HAVE_RSEQ
+    struct rseq *rs = __afl_rseq_area();
+
+    if (__afl_likely(rs != NULL))
+        return __atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED);
+#endif
+
+    __afl_syscall(__NR_getcpu, (intptr_t) &cpu, 0, 0, 0);
+
+    return cpu;
+}
+
+typedef struct
+{
+    afl_spinlock_t lock;
+} __afl_percpu_slot_t;
+
+typedef struct
+{
+    __afl_percpu_slot_t *slots;
+    uint32_t count;
+    uint32_t rseq;
+} afl_percpu_t;
+
+static inline int __afl_percpu_init(afl_percpu_t *percpu, int rseq)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+    if (cpus < 1)
+        cpus = 1;
+
+    percpu->slots = (__afl_percpu_slot_t *) aligned_alloc(
+      sizeof(__afl_percpu_slot_t), cpus * sizeof(__afl_percpu_slot_t)
+    );
+    if (!percpu->slots)
+        return ENOMEM;
+
+    for (long i = 0; i < cpus; i++)
+        afl_spin_init(&percpu->slots[i].lock, 0);
+
+    percpu->count = cpus;
+    percpu->rseq  = rseq && __afl_rseq_area() != NULL;
+
+    return 0;
+}
+
+static inline int afl_percpu_init(afl_percpu_t *percpu)
+{
+    return __afl_percpu_init(percpu, AFL_HAVE_RSEQ);
+}
+
+/*
+ * Always uses the sharded afl_spinlock_t fallback.
+ */
+static inline int afl_percpu_sharded_init(afl_percpu_t *percpu)
+{
+    return __afl_percpu_init(percpu, 0);
+}
+
+static inline uint32_t __afl_percpu_cpu(void)
+{
+    static __thread uint32_t cpu, calls;
+
+    if (__afl_unlikely(!(calls++ % AFL_PERCPU_CPU_REFRESH)))
+        cpu = afl_rseq_cpu();
+
+    return cpu;
+}
+
+/*
+ * Takes the lock of the current CPU and stores its index in shard, the index of the per-CPU data to use
+ * and to pass to afl_percpu_unlock. ENOTSUP takes no lock, shard is still set to the fallback shard.
+ */
+static inline int afl_percpu_lock(afl_percpu_t *percpu, uint32_t *shard)
+{
+#if AFL_HAVE_RSEQ
+    if (__afl_likely(percpu->rseq)) {
+        struct rseq *rs = __afl_rseq_area();
+        uint32_t spins  = 0;
+
+        if (__afl_unlikely(!rs))
+            goto unsupported;
+
+        for (;;) {
+            uint32_t cpu = __atomic_load_n(&rs->cpu_id_start, __ATOMIC_RELAXED);
+            int ret;
+
+            if (__afl_unlikely(cpu >= percpu->count))
+                goto unsupported;
+
+            ret = __afl_rseq_cmpeqv_storev(rs, (uint32_t *) &percpu->slots[cpu].lock, AFL_UNLOCKED, AFL_LOCKED, cpu);
+            if (__afl_likely(!ret)) {
+                *shard = cpu;
+                return 0;
+            }
+
+            /* Held by a thread that was preempted or migrated inside its critical section. */
+            if (ret > 0) {
+                if (++spins % AFL_PERCPU_SPINS)
+                    __afl_pause;
+                else
+                    sched_yield();
+            }
+        }
+    }
+#endif
+
+    *shard = __afl_percpu_cpu() % percpu->count;
+
+    return afl_spin_lock(&percpu->slots[*shard].lock);
+
+#if AFL_HAVE_RSEQ
+unsupported:
+    *shard = __afl_percpu_cpu() % percpu->count;
+
+    return ENOTSUP;
+#endif
+}
+
+static inline int afl_percpu_unlock(afl_percpu_t *percpu, uint32_t shard)
+{
+    if (percpu->rseq) {
+        __atomic_store_n(&percpu->slots[shard].lock, AFL_UNLOCKED, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    return afl_spin_unlock(&percpu->slots[shard].lock);
+}
+
+static inline int afl_percpu_destroy(afl_percpu_t *percpu)
+{
+    free(percpu->slots);
+    percpu->slots = NULL;
+    percpu->count = 0;
+
+    return 0;
+}
+
+/*
+ * Big Reader Lock
+ *
+ * Distributed reader/writer lock for data that is read very often and written rarely.
+ * Every configured CPU has its own reader counter on its own cache line, a reader increments the counter
+ * of its CPU and only reads the writer word, which stays shared in all caches while there is no writer.
+ * The shard is returned to the reader and passed back to the unlock, so the thread may migrate meanwhile.
+ *
+ * A writer serializes with the other writers on an afl_mutex_t, sets the writer word and waits
+ * in futex on every reader counter until it drops to zero.  Readers that see the writer word back out
+ * and wait on it, so writers are never starved by readers.  The reader increment and the writer word load
+ * are sequentially consistent, as are the writer store and the counter loads, so either the reader sees
+ * the writer or the writer sees the reader.
+ */
+#define AFL_BR_WRITER 0x1 // A writer owns or waits for the lock
+
+typedef struct
+{
+    uint32_t readers;
+} __AFL_ALIGN __afl_brlock_slot_t;
+
+typedef struct
+{
+    uint32_t writer; // AFL_BR_WRITER and AFL_HAVE_WAITERS for readers waiting on the writer
+    uint32_t count;
+    __afl_brlock_slot_t *slots;
+    afl_mutex_t writers;
+} afl_brlock_t;
+
+static inline int afl_brlock_init(afl_brlock_t *brlock)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+    if (cpus < 1)
+        cpus = 1;
+
+    brlock->slots = (__afl_brlock_slot_t *) aligned_alloc(
+      sizeof(__afl_brlock_slot_t), cpus * sizeof(__afl_brlock_slot_t)
+    );
+    if (!brlock->slots)
+        return ENOMEM;
+
+    for (long i = 0; i < cpus; i++)
+        brlock->slots[i].readers = 0;
+
+    brlock->count   = cpus;
+    brlock->writers = AFL_MUTEX_INIT;
+    __atomic_store_n(&brlock->writer, 0, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static inline int afl_brlock_shared_lock(afl_brlock_t *brlock, uint32_t *shard)
+{
+    __afl_brlock_slot_t *slot;
+    uint32_t writer;
+
+    *shard = __afl_percpu_cpu() % brlock->count;
+    slot   = &brlock->slots[*shard];
+
+    for (;;) {
+        __atomic_add_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+        if (__afl_likely(!__atomic_load_n(&brlock->writer, __ATOMIC_SEQ_CST)))
+            return 0;
+
+        /* A writer is active, let it finish. */
+        if (!__atomic_sub_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST))
+            __afl_syscall(__NR_futex, (intptr_t) &slot->readers, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+
+        __atomic_load(&brlock->writer, &writer, __ATOMIC_RELAXED);
+        while (writer) {
+            if (!(writer & AFL_HAVE_WAITERS)
+                && !__atomic_compare_exchange_n(
+                  &brlock->writer, &writer, writer | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+                ))
+                continue;
+            __afl_syscall(
+              __NR_futex, (intptr_t) &brlock->writer, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, writer | AFL_HAVE_WAITERS, 0
+            );
+            __atomic_load(&brlock->writer, &writer, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static inline int afl_brlock_shared_unlock(afl_brlock_t *brlock, uint32_t shard)
+{
+    __afl_brlock_slot_t *slot = &brlock->slots[shard];
+
+    __afl_debug(
+      !__atomic_load_n(&slot->readers, __ATOMIC_RELAXED), "An attempt was made to unlock an unlocked big reader lock."
+    );
+
+    if (!__atomic_sub_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST)
+        && __afl_unlikely(__atomic_load_n(&brlock->writer, __ATOMIC_SEQ_CST)))
+        __afl_syscall(__NR_futex, (intptr_t) &slot->readers, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+
+    return 0;
+}
+
+static inline int afl_brlock_exclusive_lock(afl_brlock_t *brlock)
+{
+    afl_mutex_lock(&brlock->writers);
+
+    __atomic_or_fetch(&brlock->writer, AFL_BR_WRITER, __ATOMIC_SEQ_CST);
+
+    for (uint32_t i = 0; i < brlock->count; i++) {
+        uint32_t readers;
+
+        while ((readers = __atomic_load_n(&brlock->slots[i].readers, __ATOMIC_SEQ_CST)))
+            __afl_syscall(
+              __NR_futex, (intptr_t) &brlock->slots[i].readers, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, readers, 0
+            );
+    }
+
+    return 0;
+}
+
+static inline int afl_brlock_exclusive_unlock(afl_brlock_t *brlock)
+{
+    if (__atomic_exchange_n(&brlock->writer, 0, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS)
+        __afl_syscall(__NR_futex, (intptr_t) &brlock->writer, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+    return afl_mutex_unlock(&brlock->writers);
+}
+
+static inline int afl_brlock_destroy(afl_brlock_t *brlock)
+{
+    free(brlock->slots);
+    brlock->slots = NULL;
+    brlock->count = 0;
+
+    return 0;
+}
+
+/*
+ * Sequence Lock
+ *
+ * Readers of small records copy them without writing shared memory and retry when a writer interfered.
+ * The sequence is odd while a writer is inside, writers are serialized by the embedded afl_spinlock_t,
+ * which sits on its own cache line, so readers only see writers when the sequence changes.
+ *
+ * Ordering follows the C11 seqlock: the writer makes the sequence odd and issues a release fence before the data
+ * stores, the reader loads the data and issues an acquire fence before it reads the sequence again.
+ * On x86 both fences only stop the compiler, on aarch64 they are DMB ISHLD / DMB ISH.
+ */
+#define AFL_SEQLOCK_SPINS 128 // Spins on an odd sequence before yielding to a preempted writer
+
+typedef struct
+{
+    uint32_t seq;
+    afl_spinlock_t lock;
+} afl_seqlock_t;
+
+#define AFL_SEQLOCK_INIT {0, 0}
+
+static inline int afl_seqlock_init(afl_seqlock_t *seqlock)
+{
+    afl_spin_init(&seqlock->lock, 0);
+    __atomic_store_n(&seqlock->seq, 0, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static inline int afl_seqlock_write_lock(afl_seqlock_t *seqlock)
+{
+    afl_spin_lock(&seqlock->lock);
+
+    __atomic_store_n(&seqlock->seq, seqlock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static inline int afl_seqlock_write_unlock(afl_seqlock_t *seqlock)
+{
+    __afl_debug(!(seqlock->seq & 1), "An attempt was made to unlock an unlocked seqlock.");
+
+    __atomic_store_n(&seqlock->seq, seqlock->seq + 1, __ATOMIC_RELEASE);
+
+    return afl_spin_unlock(&seqlock->lock);
+}
+
+/*
+ * Returns the sequence to pass to afl_seqlock_read_retry, waits while a writer is inside.
+ */
+static inline uint32_t afl_seqlock_read_begin(const afl_seqlock_t *seqlock)
+{
+    uint32_t seq;
+    uint32_t spins = 0;
+
+    while (__afl_unlikely((seq = __atomic_load_n(&seqlock->seq, __ATOMIC_ACQUIRE)) & 1)) {
+        if (++spins % AFL_SEQLOCK_SPINS)
+            __afl_pause;
+        else
+            sched_yield();
+    }
+
+    return seq;
+}
+
+/*
+ * Returns nonzero when a writer changed the data since afl_seqlock_read_begin and the read has to be repeated.
+ */
+static inline int afl_seqlock_read_retry(const afl_seqlock_t *seqlock, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&seqlock->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+ * Copies size bytes of the record protected by the seqlock.
+ */
+static inline int afl_seqlock_read(const afl_seqlock_t *seqlock, void *to, const void *from, size_t size)
+{
+    uint32_t seq;
+
+    do {
+        seq = afl_seqlock_read_begin(seqlock);
+        __builtin_memcpy(to, from, size);
+    } while (afl_seqlock_read_retry(seqlock, seq));
+
+    return 0;
+}
+
+static inline int afl_seqlock_destroy(afl_seqlock_t *seqlock)
+{
+    return afl_seqlock_init(seqlock);
+}
+
+/*
+ * Semaphore
+ *
+ * The value word holds the count and is the futex word, waiters counts the threads inside the slow path.
+ * afl_sem_post makes a FUTEX_WAKE only when waiters is not zero. The count and waiters updates
+ * are sequentially consistent, so either the poster sees the waiter or the waiter sees the new count.
+ */
+typedef struct
+{
+    __attribute__((aligned(8))) uint32_t value;
+    uint32_t waiters;
+} __AFL_ALIGN afl_sem_t;
+
+#define AFL_SEM_INIT(value) \
+    {                       \
+        (value), 0          \
+    }
+
+#define AFL_SEM_VALUE_MAX INT32_MAX
+
+static inline int afl_sem_init(afl_sem_t *sem, uint32_t value)
+{
+    if (__afl_unlikely(value > AFL_SEM_VALUE_MAX))
+        return EINVAL;
+
+    sem->value   = value;
+    sem->waiters = 0;
+
+    return 0;
+}
+
+static inline int afl_sem_trywait(afl_sem_t *sem)
+{
+    uint32_t value = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+
+    while (value) {
+        if (__afl_likely(__atomic_compare_exchange_n(&sem->value, &value, value - 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+            return 0;
+    }
+
+    return EAGAIN;
+}
+
+/*
+ * Wait with an absolute CLOCK_MONOTONIC deadline, NULL waits forever.
+ */
+static inline int afl_sem_timedwait(afl_sem_t *sem, const struct timespec *abstime)
+{
+    int ret = 0;
+
+    if (__afl_likely(!afl_sem_trywait(sem)))
+        return 0;
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __atomic_add_fetch(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+
+    for (;;) {
+        uint32_t value = __atomic_load_n(&sem->value, __ATOMIC_SEQ_CST);
+
+        if (value) {
+            if (__atomic_compare_exchange_n(&sem->value, &value, value - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                break;
+            continue;
+        }
+
+        ret = __afl_futex_wait_until(&sem->value, 0, abstime);
+
+        if (ret == -ETIMEDOUT) {
+            ret = afl_sem_trywait(sem) ? ETIMEDOUT : 0;
+            break;
+        }
+
+        if (__afl_unlikely(ret < 0 && ret != -EAGAIN && ret != -EINTR)) {
+            ret = -ret;
+            break;
+        }
+
+        ret = 0;
+    }
+
+    __atomic_sub_fetch(&sem->waiters, 1, __ATOMIC_RELAXED);
+
+    return ret;
+}
+
+static inline int afl_sem_reltimedwait(afl_sem_t *sem, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_sem_timedwait(sem, &abstime);
+}
+
+static inline int afl_sem_wait(afl_sem_t *sem)
+{
+    return afl_sem_timedwait(sem, NULL);
+}
+
+/*
+ * Release count units at once and wake at most count waiters with a single FUTEX_WAKE.
+ */
+static inline int afl_sem_post_n(afl_sem_t *sem, uint32_t count)
+{
+    uint32_t value = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+
+    do {
+        if (__afl_unlikely(count > AFL_SEM_VALUE_MAX - value))
+            return EOVERFLOW;
+    } while (!__atomic_compare_exchange_n(&sem->value, &value, value + count, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    if (__afl_unlikely(__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST)))
+        __afl_syscall(__NR_futex, (intptr_t) &sem->value, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, 0);
+
+    return 0;
+}
+
+static inline int afl_sem_post(afl_sem_t *sem)
+{
+    return afl_sem_post_n(sem, 1);
+}
+
+static inline uint32_t afl_sem_getvalue(afl_sem_t *sem)
+{
+    return __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+}
+
+static inline int afl_sem_destroy(afl_sem_t *sem)
+{
+    __afl_debug(__atomic_load_n(&sem->waiters, __ATOMIC_RELAXED), "Semaphore destroyed while threads are waiting!");
+    return 0;
+}
+
+/*
+ * Event
+ *
+ * Manual-reset and auto-reset events like Windows SetEvent, ResetEvent, PulseEvent and WaitForSingleObject.
+ * Everything lives in one futex word: the signaled state, the mode, the number of waiters
+ * and a generation that afl_event_pulse advances to release the waiters of a manual-reset event.
+ *
+ * A manual-reset event stays signaled and afl_event_set wakes all waiters.
+ * An auto-reset event is reset by the single waiter that consumes the signal and afl_event_set wakes one waiter.
+ * afl_event_set and afl_event_pulse call FUTEX_WAKE only when waiters are counted in the word,
+ * the waiters field holds up to 16383 threads, a wait beyond that returns EAGAIN instead of blocking.
+ */
+typedef __AFL_ALIGN uint32_t afl_event_t;
+
+#define AFL_EVENT_SIGNALED 0x00000001
+#define AFL_EVENT_MANUAL 0x00000002
+#define AFL_EVENT_WAITER 0x00000004
+#define AFL_EVENT_WAITERS_MASK 0x0000FFFC
+#define AFL_EVENT_GENERATION 0x00010000
+#define AFL_EVENT_GENERATION_MASK 0xFFFF0000
+
+#define AFL_EVENT_INIT(manual, signaled) (((manual) ? AFL_EVENT_MANUAL : 0) | ((signaled) ? AFL_EVENT_SIGNALED : 0))
+
+static inline int afl_event_init(afl_event_t *event, int manual, int signaled)
+{
+    *event = AFL_EVENT_INIT(manual, signaled);
+
+    return 0;
+}
+
+static inline int afl_event_trywait(afl_event_t *event)
+{
+    uint32_t value = __atomic_load_n(event, __ATOMIC_ACQUIRE);
+
+    while (value & AFL_EVENT_SIGNALED) {
+        if (value & AFL_EVENT_MANUAL)
+            return 0;
+        if (__afl_likely(__atomic_compare_exchange_n(
+              event, &value, value & ~AFL_EVENT_SIGNALED, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+            )))
+            return 0;
+    }
+
+    return EAGAIN;
+}
+
+/*
+ * Wait with an absolute CLOCK_MONOTONIC deadline, NULL waits forever.
+ * The waiter is counted in the word while it sleeps, so every change of the word makes futex return EAGAIN
+ * and the state is checked again.
+ */
+static inline int afl_event_timedwait(afl_event_t *event, const struct timespec *abstime)
+{
+    uint32_t value, generation;
+    int ret;
+
+    if (__afl_likely(!afl_event_trywait(event)))
+        return 0;
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    __atomic_load(event, &value, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        if (value & AFL_EVENT_SIGNALED) {
+            uint32_t consumed = value & AFL_EVENT_MANUAL ? value : value & ~AFL_EVENT_SIGNALED;
+            if (__atomic_compare_exchange_n(event, &value, consumed, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+                return 0;
+            continue;
+        }
+        __afl_debug(
+          (value & AFL_EVENT_WAITERS_MASK) == AFL_EVENT_WAITERS_MASK,
+          "Event waiter counter overflow. "
+          "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+        );
+        if (__afl_unlikely((value & AFL_EVENT_WAITERS_MASK) == AFL_EVENT_WAITERS_MASK))
+            return EAGAIN;
+        if (__atomic_compare_exchange_n(event, &value, value + AFL_EVENT_WAITER, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    value += AFL_EVENT_WAITER;
+    generation = value & AFL_EVENT_GENERATION_MASK;
+
+    for (;;) {
+        ret = __afl_futex_wait_until(event, value, abstime);
+
+        __atomic_load(event, &value, __ATOMIC_ACQUIRE);
+
+        for (;;) {
+            if (value & AFL_EVENT_SIGNALED) {
+                uint32_t consumed = value - AFL_EVENT_WAITER;
+                if (!(value & AFL_EVENT_MANUAL))
+                    consumed &= ~AFL_EVENT_SIGNALED;
+                if (__atomic_compare_exchange_n(event, &value, consumed, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+                    return 0;
+                continue;
+            }
+            if ((value & AFL_EVENT_GENERATION_MASK) != generation || ret == -ETIMEDOUT) {
+                if (__atomic_compare_exchange_n(
+                      event, &value, value - AFL_EVENT_WAITER, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+                    ))
+                    return (value & AFL_EVENT_GENERATION_MASK) != generation ? 0 : ETIMEDOUT;
+                continue;
+            }
+            break;
+        }
+    }
+}
+
+static inline int afl_event_reltimedwait(afl_event_t *event, const struct timespec *timeout)
+{
+    struct timespec abstime;
+
+    __afl_deadline(&abstime, timeout);
+
+    return afl_event_timedwait(event, &abstime);
+}
+
+static inline int afl_event_wait(afl_event_t *event)
+{
+    return afl_event_timedwait(event, NULL);
+}
+
+static inline int afl_event_set(afl_event_t *event)
+{
+    uint32_t value = __atomic_load_n(event, __ATOMIC_RELAXED);
+
+    do {
+        if (value & AFL_EVENT_SIGNALED)
+            return 0;
+    } while (!__atomic_compare_exchange_n(
+      event, &value, value | AFL_EVENT_SIGNALED, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED
+    ));
+
+    if (value & AFL_EVENT_WAITERS_MASK)
+        __afl_syscall(
+          __NR_futex, (intptr_t) event, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, value & AFL_EVENT_MANUAL ? INT32_MAX : 1, 0
+        );
+
+    return 0;
+}
+
+static inline int afl_event_reset(afl_event_t *event)
+{
+    __atomic_fetch_and(event, ~AFL_EVENT_SIGNALED, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/*
+ * Release the threads waiting right now and leave the event reset.
+ * A manual-reset event advances the generation and wakes all waiters.
+ * An auto-reset event with waiters is signaled and one waiter is woken to consume the signal,
+ * so the event stays signaled if that waiter times out first. Without waiters it is only reset.
+ */
+static inline int afl_event_pulse(afl_event_t *event)
+{
+    uint32_t value = __atomic_load_n(event, __ATOMIC_RELAXED);
+    uint32_t pulsed;
+
+    do {
+        if (value & AFL_EVENT_MANUAL)
+            pulsed = (value & ~AFL_EVENT_SIGNALED) + AFL_EVENT_GENERATION;
+        else if (value & AFL_EVENT_WAITERS_MASK)
+            pulsed = value | AFL_EVENT_SIGNALED;
+        else
+            pulsed = value & ~AFL_EVENT_SIGNALED;
+    } while (!__atomic_compare_exchange_n(event, &value, pulsed, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (value & AFL_EVENT_WAITERS_MASK)
+        __afl_syscall(
+          __NR_futex, (intptr_t) event, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, value & AFL_EVENT_MANUAL ? INT32_MAX : 1, 0
+        );
+
+    return 0;
+}
+
+static inline int afl_event_destroy(afl_event_t *event)
+{
+    __afl_debug(
+      __atomic_load_n(event, __ATOMIC_RELAXED) & AFL_EVENT_WAITERS_MASK, "Event destroyed while threads are waiting!"
+    );
+    return 0;
+}
+
+/*
+ * Barrier
+ *
+ * Reusable barrier for a fixed number of threads. The futex word holds the threads arrived in the current phase,
+ * the phase generation and AFL_HAVE_WAITERS. The last thread to arrive starts the next generation
+ * and releases every sleeping thread with a single FUTEX_WAKE, made only when one of them set AFL_HAVE_WAITERS.
+ * afl_barrier_wait returns AFL_BARRIER_SERIAL_THREAD in the last thread and 0 in the others,
+ * like PTHREAD_BARRIER_SERIAL_THREAD.
+ */
+typedef struct
+{
+    __attribute__((aligned(8))) uint32_t lock;
+    uint32_t count;
+} __AFL_ALIGN afl_barrier_t;
+
+#define AFL_BARRIER_INIT(count) \
+    {                           \
+        0, (count)              \
+    }
+
+#define AFL_BARRIER_SERIAL_THREAD -1
+#define AFL_BARRIER_ARRIVED_MASK 0x00007FFF
+#define AFL_BARRIER_GENERATION 0x00008000
+#define AFL_BARRIER_GENERATION_MASK 0x7FFF8000
+
+static inline int afl_barrier_init(afl_barrier_t *barrier, uint32_t count)
+{
+    if (__afl_unlikely(!count || count > AFL_BARRIER_ARRIVED_MASK))
+        return EINVAL;
+
+    barrier->lock  = 0;
+    barrier->count = count;
+
+    return 0;
+}
+
+static inline int afl_barrier_wait(afl_barrier_t *barrier)
+{
+    uint32_t lock = __atomic_fetch_add(&barrier->lock, 1, __ATOMIC_ACQ_REL);
+    uint32_t generation = lock & AFL_BARRIER_GENERATION_MASK;
+
+    if ((lock & AFL_BARRIER_ARRIVED_MASK) + 1 == barrier->count) {
+        lock = __atomic_exchange_n(
+          &barrier->lock, (generation + AFL_BARRIER_GENERATION) & AFL_BARRIER_GENERATION_MASK, __ATOMIC_RELEASE
+        );
+
+        if (lock & AFL_HAVE_WAITERS)
+            __afl_syscall(__NR_futex, (intptr_t) &barrier->lock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+        return AFL_BARRIER_SERIAL_THREAD;
+    }
+
+    lock++;
+
+    for (;;) {
+        if ((lock & AFL_BARRIER_GENERATION_MASK) != generation)
+            return 0;
+
+        if ((lock & AFL_HAVE_WAITERS)
+            || __atomic_compare_exchange_n(
+              &barrier->lock, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+            ))
+            __afl_syscall(__NR_futex, (intptr_t) &barrier->lock, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock | AFL_HAVE_WAITERS, 0);
+        else
+            continue;
+
+        __atomic_load(&barrier->lock, &lock, __ATOMIC_ACQUIRE);
+    }
+}
+
+static inline int afl_barrier_destroy(afl_barrier_t *barrier)
+{
+    __afl_debug(
+      __atomic_load_n(&barrier->lock, __ATOMIC_RELAXED) & AFL_BARRIER_ARRIVED_MASK,
+      "Barrier destroyed while threads are waiting!"
+    );
+    return 0;
+}
+
+/*
+ * Countdown Latch
+ *
+ * One-shot latch on a single futex word: the count and AFL_HAVE_WAITERS.
+ * The thread that counts down to zero releases every waiter with a single FUTEX_WAKE.
+ */
+typedef __AFL_ALIGN uint32_t afl_latch_t;
+
+#define AFL_LATCH_INIT(count) (count)
+#define AFL_LATCH_COUNT_MASK 0x7FFFFFFF
+
+static inline int afl_latch_init(afl_latch_t *latch, uint32_t count)
+{
+    if (__afl_unlikely(count > AFL_LATCH_COUNT_MASK))
+        return EINVAL;
+
+    *latch = count;
+
+    return 0;
+}
+
+static inline int afl_latch_count_down(afl_latch_t *latch, uint32_t update)
+{
+    uint32_t lock = __atomic_load_n(latch, __ATOMIC_RELAXED);
+
+    do {
+        if (__afl_unlikely(update > (lock & AFL_LATCH_COUNT_MASK)))
+            return EINVAL;
+    } while (!__atomic_compare_exchange_n(latch, &lock, lock - update, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if ((lock & AFL_LATCH_COUNT_MASK) == update && (lock & AFL_HAVE_WAITERS))
+        __afl_syscall(__NR_futex, (intptr_t) latch, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+    return 0;
+}
+
+static inline int afl_latch_trywait(afl_latch_t *latch)
+{
+    return __atomic_load_n(latch, __ATOMIC_ACQUIRE) & AFL_LATCH_COUNT_MASK ? EBUSY : 0;
+}
+
+static inline int afl_latch_wait(afl_latch_t *latch)
+{
+    uint32_t lock;
+
+    __atomic_load(latch, &lock, __ATOMIC_ACQUIRE);
+
+    while (lock & AFL_LATCH_COUNT_MASK) {
+        if ((lock & AFL_HAVE_WAITERS)
+            || __atomic_compare_exchange_n(latch, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            __afl_syscall(__NR_futex, (intptr_t) latch, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, lock | AFL_HAVE_WAITERS, 0);
+        else
+            continue;
+
+        __atomic_load(latch, &lock, __ATOMIC_ACQUIRE);
+    }
+
+    return 0;
+}
+
+static inline int afl_latch_arrive_and_wait(afl_latch_t *latch, uint32_t update)
+{
+    int ret = afl_latch_count_down(latch, update);
+
+    if (__afl_unlikely(ret))
+        return ret;
+
+    return afl_latch_wait(latch);
+}
+
+static inline int afl_latch_destroy(afl_latch_t *latch)
+{
+    __atomic_store_n(latch, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Wait for Multiple Objects
+ *
+ * afl_wait_any blocks on up to AFL_WAIT_MAX afl mutexes and once objects in a single futex_waitv syscall
+ * (Linux 5.16) and returns the index of the object that became available:
+ * a mutex is acquired by the caller like WaitForMultipleObjects does, a once object is complete.
+ *
+ * Before sleeping every busy object gets AFL_HAVE_WAITERS, so afl_mutex_unlock and afl_once wake the waiter.
+ * A woken waiter first takes the mutex that woke it with the afl_mutex_lock slow path exchange.
+ * futex_waitv reports a single index, yet a FUTEX_WAKE(1) of any other listed mutex may have been spent on
+ * the waiter, which then leaves that mutex unlocked with AFL_HAVE_WAITERS cleared and its sleepers parked.
+ * So after a wake the waiter passes a wake on to the other mutexes still unlocked, a spurious wake is harmless.
+ *
+ * Older kernels return ENOSYS, then the objects are polled with a sleep that doubles up to AFL_WAIT_POLL_MAX_NS.
+ * The deadline is an absolute CLOCK_MONOTONIC time, NULL waits forever, an invalid one returns EINVAL.
+ */
+#define AFL_WAIT_MAX 128
+#define AFL_WAIT_POLL_MIN_NS 1000
+#define AFL_WAIT_POLL_MAX_NS 1000000
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+#ifndef FUTEX2_SIZE_U32
+#define FUTEX2_SIZE_U32 0x02
+#endif
+
+#ifndef FUTEX2_PRIVATE
+#define FUTEX2_PRIVATE FUTEX_PRIVATE_FLAG
+#endif
+
+enum __afl_wait_type
+{
+    AFL_WAIT_MUTEX = 0, // afl_mutex_t, acquired by the wait
+    AFL_WAIT_ONCE  = 1  // afl_once_t, available when complete
+};
+
+typedef struct
+{
+    uint32_t *futex;
+    uint32_t type;
+} afl_wait_object_t;
+
+#define AFL_WAIT_MUTEX_OBJECT(mutex) ((afl_wait_object_t) {(uint32_t *) (mutex), AFL_WAIT_MUTEX})
+#define AFL_WAIT_ONCE_OBJECT(once) ((afl_wait_object_t) {(uint32_t *) (once), AFL_WAIT_ONCE})
+
+struct __afl_futex_waitv
+{
+    uint64_t val;
+    uint64_t uaddr;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static inline int __afl_wait_try(const afl_wait_object_t *object)
+{
+    uint32_t lock;
+
+    if (object->type == AFL_WAIT_ONCE)
+        return !!(__atomic_load_n(object->futex, __ATOMIC_ACQUIRE) & AFL_SUCCESS);
+
+    lock = AFL_UNLOCKED;
+    return __atomic_compare_exchange_n(object->futex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/*
+ * Set AFL_HAVE_WAITERS on a busy object and return the value to wait on, or 0 when the object became available.
+ */
+static inline uint32_t __afl_wait_prepare(const afl_wait_object_t *object)
+{
+    uint32_t lock;
+
+    __atomic_load(object->futex, &lock, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        if (object->type == AFL_WAIT_ONCE && (lock & AFL_SUCCESS))
+            return 0;
+        if (object->type == AFL_WAIT_MUTEX && lock == AFL_UNLOCKED) {
+            if (__atomic_compare_exchange_n(object->futex, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+                return 0;
+            continue;
+        }
+        if ((lock & AFL_HAVE_WAITERS)
+            || __atomic_compare_exchange_n(
+              object->futex, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+            ))
+            return lock | AFL_HAVE_WAITERS;
+    }
+}
+
+static inline int __afl_wait_any_poll(
+  const afl_wait_object_t *objects, uint32_t count, uint32_t *index, const struct timespec *abstime
+)
+{
+    struct timespec sleep = {0, AFL_WAIT_POLL_MIN_NS};
+
+    for (;;) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (__afl_wait_try(&objects[i])) {
+                *index = i;
+                return 0;
+            }
+        }
+
+        if (abstime && __afl_deadline_passed(abstime))
+            return ETIMEDOUT;
+
+        nanosleep(&sleep, NULL);
+        if (sleep.tv_nsec < AFL_WAIT_POLL_MAX_NS)
+            sleep.tv_nsec <<= 1;
+    }
+}
+
+/*
+ * Wake one sleeper of every unlocked mutex except `woken`, called only after futex_waitv was woken.
+ * A locked mutex is skipped, its next unlock sees the AFL_HAVE_WAITERS bit this waiter set and wakes a sleeper.
+ */
+static inline void __afl_wait_forward(const afl_wait_object_t *objects, uint32_t count, uint32_t woken)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (objects[i].type != AFL_WAIT_MUTEX || i == woken)
+            continue;
+        if (__atomic_load_n(objects[i].futex, __ATOMIC_RELAXED) != AFL_UNLOCKED)
+            continue;
+        __afl_syscall(__NR_futex, (intptr_t) objects[i].futex, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, 0);
+    }
+}
+
+static inline int afl_wait_any(
+  const afl_wait_object_t *objects, uint32_t count, uint32_t *index, const struct timespec *abstime
+)
+{
+    static uint32_t nosys;
+    struct __afl_futex_waitv waiters[AFL_WAIT_MAX];
+    int ret;
+
+    if (__afl_unlikely(!count || count > AFL_WAIT_MAX))
+        return EINVAL;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (__afl_wait_try(&objects[i])) {
+            *index = i;
+            return 0;
+        }
+    }
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    if (__afl_unlikely(__atomic_load_n(&nosys, __ATOMIC_RELAXED)))
+        return __afl_wait_any_poll(objects, count, index, abstime);
+
+    for (;;) {
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t value = __afl_wait_prepare(&objects[i]);
+            if (!value) {
+                *index = i;
+                return 0;
+            }
+            waiters[i].val      = value;
+            waiters[i].uaddr    = (uintptr_t) objects[i].futex;
+            waiters[i].flags    = FUTEX2_SIZE_U32 | FUTEX2_PRIVATE;
+            waiters[i].reserved = 0;
+        }
+
+        ret = __afl_syscall6(__NR_futex_waitv, (intptr_t) waiters, count, 0, (intptr_t) abstime, CLOCK_MONOTONIC, 0);
+
+        if (ret >= 0 && (uint32_t) ret < count) {
+            __afl_wait_forward(objects, count, ret);
+            if (objects[ret].type == AFL_WAIT_ONCE
+                    ? !!(__atomic_load_n(objects[ret].futex, __ATOMIC_ACQUIRE) & AFL_SUCCESS)
+                    : __atomic_exchange_n(objects[ret].futex, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE)
+                        == AFL_UNLOCKED) {
+                *index = ret;
+                return 0;
+            }
+        } else if (__afl_unlikely(ret == -ENOSYS)) {
+            __atomic_store_n(&nosys, 1, __ATOMIC_RELAXED);
+            return __afl_wait_any_poll(objects, count, index, abstime);
+        } else if (ret != -EAGAIN && ret != -EINTR) {
+            return -ret;
+        }
+    }
+}
+
+static inline int afl_lock_any(
+  afl_mutex_t *const *mutexes, uint32_t count, uint32_t *index, const struct timespec *abstime
+)
+{
+    afl_wait_object_t objects[AFL_WAIT_MAX];
+
+    if (__afl_unlikely(!count || count > AFL_WAIT_MAX))
+        return EINVAL;
+
+    for (uint32_t i = 0; i < count; i++)
+        objects[i] = AFL_WAIT_MUTEX_OBJECT(mutexes[i]);
+
+    return afl_wait_any(objects, count, index, abstime);
+}
+
+/*
+ * Wait on Address
+ *
+ * afl_wait_on_address blocks while the 1, 2, 4 or 8-byte word at `address` still equals the word at `compare`,
+ * afl_wake_by_address_single and afl_wake_by_address_all wake threads waiting on an address after it was changed,
+ * like WaitOnAddress and WakeByAddressSingle/All. Returns 0 when woken, also spuriously or when the word already
+ * differs, so callers re-check their condition. The deadline is an absolute CLOCK_MONOTONIC time, NULL waits forever.
+ * The word must be naturally aligned and the deadline valid, otherwise EINVAL is returned.
+ *
+ * 4-byte words are futexes, waiters sleep on the word itself and a single wake wakes one of them.
+ * futex2 defines FUTEX2_SIZE_U8/U16/U64 but the kernel accepts only FUTEX2_SIZE_U32, so other sizes sleep on
+ * the sequence word of a bucket in a table hashed by address. Every wake of the bucket advances the sequence
+ * and wakes all of its sleepers, the ones of other addresses return spuriously.
+ *
+ * Each bucket also counts the threads inside the wait, so a wake without waiters takes no syscall.
+ * The table is a weak symbol, every translation unit of a program shares it.
+ */
+#ifndef AFL_ADDRESS_TABLE_BITS
+#define AFL_ADDRESS_TABLE_BITS 8
+#endif
+
+typedef struct
+{
+    uint32_t sequence;      // Advanced by every wake of a sized waiter, they sleep on it
+    uint32_t waiters;       // Threads waiting on a 4-byte word in the bucket
+    uint32_t sized_waiters; // Threads waiting on the sequence
+} __AFL_ALIGN __afl_address_bucket_t;
+
+__attribute__((weak)) __afl_address_bucket_t __afl_address_table[1 << AFL_ADDRESS_TABLE_BITS];
+
+static inline __afl_address_bucket_t *__afl_address_bucket(const void *address)
+{
+    uint64_t hash = (uint64_t) (uintptr_t) address * UINT64_C(0x9E3779B97F4A7C15);
+
+    return &__afl_address_table[hash >> (64 - AFL_ADDRESS_TABLE_BITS)];
+}
+
+static inline int __afl_address_equal(const void *address, const void *compare, size_t size)
+{
+    switch (size) {
+    case 1:
+        return __atomic_load_n((const uint8_t *) address, __ATOMIC_SEQ_CST) == *(const uint8_t *) compare;
+    case 2:
+        return __atomic_load_n((const uint16_t *) address, __ATOMIC_SEQ_CST) == *(const uint16_t *) compare;
+    case 4:
+        return __atomic_load_n((const uint32_t *) address, __ATOMIC_SEQ_CST) == *(const uint32_t *) compare;
+    default:
+        return __atomic_load_n((const uint64_t *) address, __ATOMIC_SEQ_CST) == *(const uint64_t *) compare;
+    }
+}
+
+static inline int afl_wait_on_address(
+  const void *address, const void *compare, size_t size, const struct timespec *abstime
+)
+{
+    __afl_address_bucket_t *bucket;
+    uint32_t sequence;
+    int ret = 0;
+
+    if (__afl_unlikely((size != 1 && size != 2 && size != 4 && size != 8) || ((uintptr_t) address & (size - 1))))
+        return EINVAL;
+
+    if (__afl_unlikely(__afl_deadline_invalid(abstime)))
+        return EINVAL;
+
+    bucket = __afl_address_bucket(address);
+
+    /* The count is raised before the word is compared, a wake that misses the waiter saw the new word first. */
+    if (size == 4) {
+        __atomic_add_fetch(&bucket->waiters, 1, __ATOMIC_SEQ_CST);
+        if (__afl_address_equal(address, compare, 4))
+            ret = __afl_futex_wait_until((uint32_t *) address, *(const uint32_t *) compare, abstime);
+        __atomic_sub_fetch(&bucket->waiters, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&bucket->sized_waiters, 1, __ATOMIC_SEQ_CST);
+        sequence = __atomic_load_n(&bucket->sequence, __ATOMIC_SEQ_CST);
+        if (__afl_address_equal(address, compare, size))
+            ret = __afl_futex_wait_until(&bucket->sequence, sequence, abstime);
+        __atomic_sub_fetch(&bucket->sized_waiters, 1, __ATOMIC_RELAXED);
+    }
+
+    return ret == -ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+static inline int __afl_wake_by_address(const void *address, int count)
+{
+    __afl_address_bucket_t *bucket = __afl_address_bucket(address);
+
+    /* Order the store of the new word before the waiter counts. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&bucket->waiters, __ATOMIC_RELAXED) && !((uintptr_t) address & 3))
+        __afl_syscall(__NR_futex, (intptr_t) address, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, 0);
+
+    if (__atomic_load_n(&bucket->sized_waiters, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&bucket->sequence, 1, __ATOMIC_RELEASE);
+        __afl_syscall(__NR_futex, (intptr_t) &bucket->sequence, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+    }
+
+    return 0;
+}
+
+static inline int afl_wake_by_address_single(const void *address)
+{
+    return __afl_wake_by_address(address, 1);
+}
+
+static inline int afl_wake_by_address_all(const void *address)
+{
+    return __afl_wake_by_address(address, INT32_MAX);
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,944 @@
+#ifndef __AFL_HPP
+#define __AFL_HPP
+
+#include <chrono>
+#include <functional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "afl.h"
+
+/*
+ * Policy-based locks
+ *
+ * afl::basic_lock<Wait, Owner, Recursive, Shared> composes a lock on one 32-bit word at compile time:
+ *   Wait      - how a contended acquire waits: spin_wait, backoff_wait, futex_wait, adaptive_wait or pi_wait
+ *   Owner     - what the locked word holds: no_owner (AFL_LOCKED), tls_owner (TLS pointer) or tid_owner (gettid)
+ *   Recursive - the owner may lock again, needs an owner policy
+ *   Shared    - global futexes for locks in memory shared between processes, needs tid_owner or no_owner
+ *
+ * Every policy is a set of static inline functions selected with if constexpr, so an instantiation compiles to
+ * the same straight-line code as the matching afl_* function. The word layout and AFL_HAVE_WAITERS are those
+ * of afl_mutex_t, so native_handle() can be passed to afl_cond_wait and friends of the same algorithm.
+ *
+ * All functions return 0 or an errno value like the C API, the guards only unlock what they locked.
+ *
+ * afl::mutex, afl::recursive_mutex, afl::spinlock, afl::shared_mutex, afl::once_flag and afl::call_once
+ * follow the standard library interfaces instead, see Standard library adapters below.
+ */
+namespace afl
+{
+
+/*
+ * Ownership policies
+ */
+struct no_owner
+{
+    static constexpr bool tracked        = false;
+    static constexpr bool process_unique = true;
+
+    static uint32_t id() noexcept
+    {
+        return AFL_LOCKED;
+    }
+};
+
+struct tls_owner
+{
+    static constexpr bool tracked        = true;
+    static constexpr bool process_unique = false;
+
+    static uint32_t id() noexcept
+    {
+        return __afl_thread_pointer_tid();
+    }
+};
+
+struct tid_owner
+{
+    static constexpr bool tracked        = true;
+    static constexpr bool process_unique = true;
+
+    static uint32_t id() noexcept
+    {
+        return __afl_gettid();
+    }
+};
+
+/*
+ * Wait policies
+ *
+ * lock      - complete acquire for untracked owners
+ * lock_slow - tracked acquire after the fast compare-and-swap failed, `lock` is the value it saw
+ * unlock    - release by the owner `id`, the ownership check is done by basic_lock
+ */
+
+/*
+ * Test-and-set, see afl_spin_exchange_lock and afl_spin_owner_lock.
+ */
+struct spin_wait
+{
+    struct state
+    {
+    };
+
+    static constexpr bool needs_tid = false;
+
+    static void lock(uint32_t *word, state &, int) noexcept
+    {
+        uint32_t spins = 0;
+
+        if (__afl_likely(!__atomic_exchange_n(word, AFL_LOCKED, __ATOMIC_ACQUIRE))) {
+            __afl_stats_acquired(word);
+            return;
+        }
+
+        __afl_stats_begin(start);
+
+        do {
+            __afl_pause;
+            spins++;
+        } while (__atomic_exchange_n(word, AFL_LOCKED, __ATOMIC_ACQUIRE) != AFL_UNLOCKED);
+
+        __afl_stats_contended(word, start, spins);
+    }
+
+    static void lock_slow(uint32_t *word, state &, uint32_t lock, uint32_t id, int) noexcept
+    {
+        do {
+            __afl_pause;
+            lock = AFL_UNLOCKED;
+        } while (!__atomic_compare_exchange_n(word, &lock, id, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    }
+
+    static void unlock(uint32_t *word, uint32_t, int) noexcept
+    {
+        __atomic_store_n(word, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    }
+};
+
+/*
+ * Test-and-test-and-set with exponential backoff, see afl_spin_ttas_lock.
+ */
+struct backoff_wait
+{
+    struct state
+    {
+    };
+
+    static constexpr bool needs_tid = false;
+
+    static void lock(uint32_t *word, state &s, int private_flag) noexcept
+    {
+        if (__afl_likely(!__atomic_exchange_n(word, AFL_LOCKED, __ATOMIC_ACQUIRE))) {
+            __afl_stats_acquired(word);
+            return;
+        }
+
+        __afl_stats_begin(start);
+
+        lock_slow(word, s, AFL_LOCKED, AFL_LOCKED, private_flag);
+
+        __afl_stats_contended(word, start, 0);
+    }
+
+    static void lock_slow(uint32_t *word, state &, uint32_t lock, uint32_t id, int) noexcept
+    {
+        uint32_t backoff = AFL_SPIN_BACKOFF_MIN;
+
+        for (;;) {
+            for (uint32_t i = 0; i < backoff; i++)
+                __afl_pause;
+
+            if (backoff < AFL_SPIN_BACKOFF_MAX)
+                backoff <<= 1;
+
+            __atomic_load(word, &lock, __ATOMIC_RELAXED);
+            if (lock == AFL_UNLOCKED
+                && __atomic_compare_exchange_n(word, &lock, id, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return;
+        }
+    }
+
+    static void unlock(uint32_t *word, uint32_t, int) noexcept
+    {
+        __atomic_store_n(word, AFL_UNLOCKED, __ATOMIC_RELEASE);
+    }
+};
+
+/*
+ * Futex with AFL_HAVE_WAITERS, see afl_mutex_lock and afl_mutex_owner_lock.
+ */
+struct futex_wait
+{
+    struct state
+    {
+    };
+
+    static constexpr bool needs_tid = false;
+
+    static void lock(uint32_t *word, state &, int private_flag) noexcept
+    {
+        uint32_t lock;
+
+        __atomic_load(word, &lock, __ATOMIC_RELAXED);
+
+        if (!(lock & AFL_HAVE_WAITERS)) {
+            lock = AFL_UNLOCKED;
+            if (__afl_likely(
+                  __atomic_compare_exchange_n(word, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+                )) {
+                __afl_stats_acquired(word);
+                return;
+            }
+        }
+
+        __afl_stats_begin(start);
+
+        if (!(lock & AFL_HAVE_WAITERS))
+            lock = __atomic_exchange_n(word, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+
+        while (lock != AFL_UNLOCKED) {
+            __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAIT | private_flag, AFL_LOCKED | AFL_HAVE_WAITERS, 0);
+            __afl_stats_futex_wait(word);
+            lock = __atomic_exchange_n(word, AFL_LOCKED | AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+        }
+
+        __afl_stats_contended(word, start, 0);
+    }
+
+    static void lock_slow(uint32_t *word, state &, uint32_t lock, uint32_t id, int private_flag) noexcept
+    {
+        for (;;) {
+            if (!(lock & AFL_HAVE_WAITERS)) {
+                lock = __atomic_or_fetch(word, AFL_HAVE_WAITERS, __ATOMIC_ACQUIRE);
+                if (lock == AFL_HAVE_WAITERS
+                    && __atomic_compare_exchange_n(
+                      word, &lock, id | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+                    ))
+                    return;
+            }
+
+            __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAIT | private_flag, lock, 0);
+            __afl_stats_futex_wait(word);
+            lock = AFL_UNLOCKED;
+            if (__atomic_compare_exchange_n(word, &lock, id | AFL_HAVE_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return;
+        }
+    }
+
+    static void unlock(uint32_t *word, uint32_t, int private_flag) noexcept
+    {
+        if (__atomic_exchange_n(word, AFL_UNLOCKED, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS) {
+            __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_WAKE | private_flag, 1, 0);
+            __afl_stats_futex_wake(word);
+        }
+    }
+};
+
+/*
+ * Spin within a learned budget, then park like futex_wait, see afl_mutex_adaptive_lock.
+ */
+struct adaptive_wait
+{
+    struct state
+    {
+        uint32_t spins = 0;
+    };
+
+    static constexpr bool needs_tid = false;
+
+    static void lock(uint32_t *word, state &s, int private_flag) noexcept
+    {
+        uint32_t lock = AFL_UNLOCKED;
+
+        if (__afl_likely(__atomic_compare_exchange_n(word, &lock, AFL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+            __afl_stats_acquired(word);
+            return;
+        }
+
+        __afl_stats_begin(start);
+
+        lock_slow(word, s, lock, AFL_LOCKED, private_flag);
+
+        __afl_stats_contended(word, start, 0);
+    }
+
+    static void lock_slow(uint32_t *word, state &s, uint32_t lock, uint32_t id, int private_flag) noexcept
+    {
+        uint32_t spins, max_spins, count = 0;
+        futex_wait::state parked;
+
+        if (!(lock & AFL_HAVE_WAITERS)) {
+            spins     = __atomic_load_n(&s.spins, __ATOMIC_RELAXED);
+            max_spins = __afl_adaptive_max_spins();
+            if (max_spins > spins * 2 + 10)
+                max_spins = spins * 2 + 10;
+
+            for (; count < max_spins; count++) {
+                __afl_pause;
+                __atomic_load(word, &lock, __ATOMIC_RELAXED);
+                if (lock & AFL_HAVE_WAITERS)
+                    break;
+                if (lock == AFL_UNLOCKED
+                    && __atomic_compare_exchange_n(word, &lock, id, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                    __atomic_store_n(&s.spins, spins + ((int32_t) (count - spins)) / 8, __ATOMIC_RELAXED);
+                    return;
+                }
+            }
+
+            __atomic_store_n(&s.spins, spins + ((int32_t) (count - spins)) / 8, __ATOMIC_RELAXED);
+        }
+
+        futex_wait::lock_slow(word, parked, lock, id, private_flag);
+    }
+
+    static void unlock(uint32_t *word, uint32_t id, int private_flag) noexcept
+    {
+        futex_wait::unlock(word, id, private_flag);
+    }
+};
+
+/*
+ * Priority inheritance through FUTEX_LOCK_PI, see afl_mutex_pi_lock. The kernel reads the owner from the word,
+ * so it holds the kernel Thread ID.
+ */
+struct pi_wait
+{
+    struct state
+    {
+    };
+
+    static constexpr bool needs_tid = true;
+
+    static void lock_slow(uint32_t *word, state &, uint32_t, uint32_t, int private_flag) noexcept
+    {
+        __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_LOCK_PI | private_flag, 0, 0);
+    }
+
+    static void unlock(uint32_t *word, uint32_t id, int private_flag) noexcept
+    {
+        if (!__atomic_compare_exchange_n(word, &id, AFL_UNLOCKED, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            __afl_syscall(__NR_futex, (intptr_t) word, FUTEX_UNLOCK_PI | private_flag, 0, 0);
+    }
+};
+
+template <class Wait = futex_wait, class Owner = no_owner, bool Recursive = false, bool Shared = false>
+class alignas(64) basic_lock
+{
+    static_assert(Owner::tracked || !Recursive, "A recursive lock needs an owner policy.");
+    static_assert(!Wait::needs_tid || std::is_same<Owner, tid_owner>::value, "pi_wait needs tid_owner.");
+    static_assert(!Shared || Owner::process_unique, "tls_owner is not unique across processes.");
+
+    static constexpr int private_flag = Shared ? 0 : FUTEX_PRIVATE_FLAG;
+
+    uint32_t word_ = AFL_UNLOCKED;
+    typename Wait::state state_{};
+    size_t count_ = 0; // Only used by recursive locks
+
+    int acquired() noexcept
+    {
+        if constexpr (Recursive)
+            count_ = 1;
+
+        return 0;
+    }
+
+    int relock() noexcept
+    {
+        if constexpr (Recursive) {
+            __afl_debug(
+              count_ + 1 == 0,
+              "Recusive mutex counter overflow. "
+              "This is not an error, but please check that the EAGAIN return value is being processed correctly."
+            );
+            if (__afl_unlikely(count_ + 1 == 0))
+                return EAGAIN;
+            count_++;
+            return 0;
+        } else {
+            __afl_debug(true, "An attempt was made to lock already owned mutex.");
+            return EDEADLOCK;
+        }
+    }
+
+public:
+    using wait_policy  = Wait;
+    using owner_policy = Owner;
+
+    constexpr basic_lock() noexcept = default;
+    basic_lock(const basic_lock &)            = delete;
+    basic_lock &operator=(const basic_lock &) = delete;
+
+    int lock() noexcept
+    {
+        if constexpr (!Owner::tracked) {
+            Wait::lock(&word_, state_, private_flag);
+            return 0;
+        } else {
+            uint32_t lock;
+            uint32_t id = Owner::id();
+
+            __atomic_load(&word_, &lock, __ATOMIC_RELAXED);
+
+            if (__afl_likely(
+                  !lock && __atomic_compare_exchange_n(&word_, &lock, id, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+                )) {
+                __afl_stats_acquired(&word_);
+                return acquired();
+            }
+
+            if (__afl_unlikely(id == (lock & AFL_TID_MASK)))
+                return relock();
+
+            __afl_stats_begin(start);
+
+            Wait::lock_slow(&word_, state_, lock, id, private_flag);
+
+            __afl_stats_contended(&word_, start, 0);
+
+            return acquired();
+        }
+    }
+
+    int try_lock() noexcept
+    {
+        uint32_t lock = AFL_UNLOCKED;
+        uint32_t id   = Owner::id();
+
+        if (__afl_likely(__atomic_compare_exchange_n(&word_, &lock, id, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+            __afl_stats_acquired(&word_);
+            return acquired();
+        }
+
+        if constexpr (Owner::tracked) {
+            if (id == (lock & AFL_TID_MASK))
+                return relock();
+        }
+
+        return EBUSY;
+    }
+
+    int unlock() noexcept
+    {
+        uint32_t id = Owner::id();
+
+        if constexpr (Owner::tracked) {
+            uint32_t lock;
+
+            __atomic_load(&word_, &lock, __ATOMIC_RELAXED);
+
+            __afl_debug(id != (lock & AFL_TID_MASK), "An attempt was made to unlock a mutex from a non-owner thread.");
+
+            if (__afl_unlikely(id != (lock & AFL_TID_MASK)))
+                return EPERM;
+
+            if constexpr (Recursive) {
+                __afl_debug(count_ == 0, "An attempt was made to unlock an unlocked recursive mutex.");
+                if (--count_)
+                    return 0;
+            }
+        } else {
+            __afl_debug(
+              __atomic_load_n(&word_, __ATOMIC_RELAXED) == AFL_UNLOCKED,
+              "An attempt was made to unlock an unlocked mutex."
+            );
+        }
+
+        __afl_stats_released(&word_);
+        Wait::unlock(&word_, id, private_flag);
+
+        return 0;
+    }
+
+    uint32_t *native_handle() noexcept
+    {
+        return &word_;
+    }
+};
+
+using exchange_spinlock     = basic_lock<spin_wait>;
+using ttas_spinlock         = basic_lock<backoff_wait>;
+using owner_spinlock        = basic_lock<spin_wait, tls_owner>;
+using futex_mutex           = basic_lock<futex_wait>;
+using owner_mutex           = basic_lock<futex_wait, tls_owner>;
+using adaptive_mutex        = basic_lock<adaptive_wait, tls_owner>;
+using recursive_futex_mutex = basic_lock<futex_wait, tls_owner, true>;
+using pi_mutex              = basic_lock<pi_wait, tid_owner>;
+using recursive_pi_mutex    = basic_lock<pi_wait, tid_owner, true>;
+using pshared_futex_mutex   = basic_lock<futex_wait, no_owner, false, true>;
+using pshared_owner_mutex   = basic_lock<futex_wait, tid_owner, false, true>;
+
+/*
+ * RAII guards
+ *
+ * lock_guard locks for its scope, unique_lock can also try, defer, unlock early and move ownership.
+ * A failed lock (EDEADLOCK, EAGAIN) is kept in error() and the destructor does not unlock.
+ */
+struct defer_lock_t
+{
+};
+
+struct try_to_lock_t
+{
+};
+
+inline constexpr defer_lock_t defer_lock{};
+inline constexpr try_to_lock_t try_to_lock{};
+
+template <class Lock>
+class lock_guard
+{
+    Lock &lock_;
+    int error_;
+
+public:
+    explicit lock_guard(Lock &lock) noexcept : lock_(lock), error_(lock.lock())
+    {
+    }
+
+    ~lock_guard()
+    {
+        if (__afl_likely(!error_))
+            lock_.unlock();
+    }
+
+    lock_guard(const lock_guard &)            = delete;
+    lock_guard &operator=(const lock_guard &) = delete;
+
+    int error() const noexcept
+    {
+        return error_;
+    }
+};
+
+template <class Lock>
+class unique_lock
+{
+    Lock *lock_;
+    bool owns_;
+
+public:
+    unique_lock() noexcept : lock_(nullptr), owns_(false)
+    {
+    }
+
+    explicit unique_lock(Lock &lock) noexcept : lock_(&lock), owns_(!lock.lock())
+    {
+    }
+
+    unique_lock(Lock &lock, defer_lock_t) noexcept : lock_(&lock), owns_(false)
+    {
+    }
+
+    unique_lock(Lock &lock, try_to_lock_t) noexcept : lock_(&lock), owns_(!lock.try_lock())
+    {
+    }
+
+    unique_lock(unique_lock &&other) noexcept : lock_(other.lock_), owns_(other.owns_)
+    {
+        other.lock_ = nullptr;
+        other.owns_ = false;
+    }
+
+    unique_lock &operator=(unique_lock &&other) noexcept
+    {
+        if (owns_)
+            lock_->unlock();
+        lock_       = other.lock_;
+        owns_       = other.owns_;
+        other.lock_ = nullptr;
+        other.owns_ = false;
+        return *this;
+    }
+
+    ~unique_lock()
+    {
+        if (owns_)
+            lock_->unlock();
+    }
+
+    unique_lock(const unique_lock &)            = delete;
+    unique_lock &operator=(const unique_lock &) = delete;
+
+    int lock() noexcept
+    {
+        int ret;
+
+        if (__afl_unlikely(!lock_))
+            return EPERM;
+        if (__afl_unlikely(owns_))
+            return EDEADLOCK;
+
+        ret   = lock_->lock();
+        owns_ = !ret;
+
+        return ret;
+    }
+
+    int try_lock() noexcept
+    {
+        int ret;
+
+        if (__afl_unlikely(!lock_))
+            return EPERM;
+        if (__afl_unlikely(owns_))
+            return EDEADLOCK;
+
+        ret   = lock_->try_lock();
+        owns_ = !ret;
+
+        return ret;
+    }
+
+    int unlock() noexcept
+    {
+        if (__afl_unlikely(!owns_))
+            return EPERM;
+
+        owns_ = false;
+
+        return lock_->unlock();
+    }
+
+    Lock *release() noexcept
+    {
+        Lock *lock = lock_;
+
+        lock_ = nullptr;
+        owns_ = false;
+
+        return lock;
+    }
+
+    bool owns_lock() const noexcept
+    {
+        return owns_;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return owns_;
+    }
+
+    Lock *mutex() const noexcept
+    {
+        return lock_;
+    }
+};
+
+/*
+ * Standard library adapters
+ *
+ * Drop-in types for code templated on std::mutex, std::timed_mutex, std::recursive_timed_mutex,
+ * std::shared_mutex and std::call_once, they work with std::scoped_lock, std::unique_lock, std::shared_lock,
+ * std::lock and std::condition_variable_any.
+ *
+ *   mutex           - Lockable and TimedLockable on afl_mutex_t
+ *   recursive_mutex - Lockable and TimedLockable on afl_mutex_recursive_t
+ *   spinlock        - Lockable and TimedLockable on afl_spinlock_t, afl_spin_lock picks the algorithm
+ *   shared_mutex    - Lockable and SharedLockable on afl_rwlock_t
+ *   once_flag       - call_once on afl_once_t
+ *
+ * The default constructors are constexpr and the destructors trivial, so objects with static storage duration
+ * are constant-initialized and need no guard or dynamic initializer.
+ * Errors the standard reports as exceptions throw std::system_error: recursion and reader count overflow (EAGAIN).
+ * The timed functions wait on CLOCK_MONOTONIC, which is std::chrono::steady_clock. Deadlines of other clocks
+ * are converted once on entry, so a later adjustment of that clock does not move them.
+ */
+template <class Clock, class Duration>
+inline struct timespec __afl_monotonic_deadline(const std::chrono::time_point<Clock, Duration> &abs_time) noexcept
+{
+    using std::chrono::steady_clock;
+
+    steady_clock::time_point deadline;
+    struct timespec abstime;
+
+    if constexpr (std::is_same<Clock, steady_clock>::value)
+        deadline = std::chrono::ceil<steady_clock::duration>(abs_time);
+    else
+        deadline = steady_clock::now() + std::chrono::ceil<steady_clock::duration>(abs_time - Clock::now());
+
+    /* A deadline before the clock epoch has passed, futex rejects negative times with EINVAL. */
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    if (ns < 0)
+        ns = 0;
+
+    abstime.tv_sec  = ns / 1000000000;
+    abstime.tv_nsec = ns % 1000000000;
+
+    return abstime;
+}
+
+inline void __afl_throw_error(int error)
+{
+    throw std::system_error(error, std::system_category());
+}
+
+class mutex
+{
+    afl_mutex_t mutex_ = AFL_MUTEX_INIT;
+
+public:
+    using native_handle_type = afl_mutex_t *;
+
+    constexpr mutex() noexcept = default;
+    mutex(const mutex &)            = delete;
+    mutex &operator=(const mutex &) = delete;
+
+    void lock() noexcept
+    {
+        afl_mutex_lock(&mutex_);
+    }
+
+    bool try_lock() noexcept
+    {
+        return !afl_mutex_trylock(&mutex_);
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time) noexcept
+    {
+        return try_lock_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time) noexcept
+    {
+        struct timespec abstime = __afl_monotonic_deadline(abs_time);
+
+        return !afl_mutex_timedlock(&mutex_, &abstime);
+    }
+
+    void unlock() noexcept
+    {
+        afl_mutex_unlock(&mutex_);
+    }
+
+    native_handle_type native_handle() noexcept
+    {
+        return &mutex_;
+    }
+};
+
+class recursive_mutex
+{
+    afl_mutex_recursive_t mutex_ = {AFL_UNLOCKED, 0};
+
+public:
+    using native_handle_type = afl_mutex_recursive_t *;
+
+    constexpr recursive_mutex() noexcept = default;
+    recursive_mutex(const recursive_mutex &)            = delete;
+    recursive_mutex &operator=(const recursive_mutex &) = delete;
+
+    void lock()
+    {
+        int ret = afl_mutex_recursive_lock(&mutex_);
+
+        if (__afl_unlikely(ret))
+            __afl_throw_error(ret);
+    }
+
+    bool try_lock() noexcept
+    {
+        return !afl_mutex_recursive_trylock(&mutex_);
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time) noexcept
+    {
+        return try_lock_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time) noexcept
+    {
+        struct timespec abstime = __afl_monotonic_deadline(abs_time);
+
+        return !afl_mutex_recursive_timedlock(&mutex_, &abstime);
+    }
+
+    void unlock() noexcept
+    {
+        afl_mutex_recursive_unlock(&mutex_);
+    }
+
+    native_handle_type native_handle() noexcept
+    {
+        return &mutex_;
+    }
+};
+
+class spinlock
+{
+    afl_spinlock_t spinlock_ = AFL_UNLOCKED;
+
+public:
+    using native_handle_type = afl_spinlock_t *;
+
+    constexpr spinlock() noexcept = default;
+    spinlock(const spinlock &)            = delete;
+    spinlock &operator=(const spinlock &) = delete;
+
+    void lock() noexcept
+    {
+        afl_spin_lock(&spinlock_);
+    }
+
+    bool try_lock() noexcept
+    {
+        return !afl_spin_trylock(&spinlock_);
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time) noexcept
+    {
+        return try_lock_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time) noexcept
+    {
+        struct timespec abstime = __afl_monotonic_deadline(abs_time);
+
+        return !afl_spin_timedlock(&spinlock_, &abstime);
+    }
+
+    void unlock() noexcept
+    {
+        afl_spin_unlock(&spinlock_);
+    }
+
+    native_handle_type native_handle() noexcept
+    {
+        return &spinlock_;
+    }
+};
+
+class shared_mutex
+{
+    afl_rwlock_t rwlock_ = AFL_RWLOCK_INIT;
+
+public:
+    using native_handle_type = afl_rwlock_t *;
+
+    constexpr shared_mutex() noexcept = default;
+    shared_mutex(const shared_mutex &)            = delete;
+    shared_mutex &operator=(const shared_mutex &) = delete;
+
+    void lock() noexcept
+    {
+        afl_rwlock_exclusive_lock(&rwlock_);
+    }
+
+    bool try_lock() noexcept
+    {
+        return !afl_rwlock_exclusive_trylock(&rwlock_);
+    }
+
+    void unlock() noexcept
+    {
+        afl_rwlock_exclusive_unlock(&rwlock_);
+    }
+
+    void lock_shared()
+    {
+        int ret = afl_rwlock_shared_lock(&rwlock_);
+
+        if (__afl_unlikely(ret))
+            __afl_throw_error(ret);
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        return !afl_rwlock_shared_trylock(&rwlock_);
+    }
+
+    void unlock_shared() noexcept
+    {
+        afl_rwlock_shared_unlock(&rwlock_);
+    }
+
+    native_handle_type native_handle() noexcept
+    {
+        return &rwlock_;
+    }
+};
+
+class once_flag
+{
+    afl_once_t once_ = AFL_ONCE_INIT;
+
+    template <class Callable, class... Args>
+    friend void call_once(once_flag &flag, Callable &&f, Args &&...args);
+
+public:
+    using native_handle_type = afl_once_t *;
+
+    constexpr once_flag() noexcept = default;
+    once_flag(const once_flag &)            = delete;
+    once_flag &operator=(const once_flag &) = delete;
+
+    native_handle_type native_handle() noexcept
+    {
+        return &once_;
+    }
+};
+
+/*
+ * The protocol of __afl_once with a callable and arguments instead of a plain function pointer.
+ * When the callable throws, the word goes back to AFL_UNLOCKED and all waiters are woken,
+ * one of them runs the callable again and the exception propagates to the caller like std::call_once.
+ */
+template <class Callable, class... Args>
+void call_once(once_flag &flag, Callable &&f, Args &&...args)
+{
+    afl_once_t *once = &flag.once_;
+    uint32_t lock;
+
+    __atomic_load(once, &lock, __ATOMIC_ACQUIRE);
+
+    if (__afl_likely(lock & AFL_SUCCESS))
+        return;
+
+    for (;;) {
+        lock &= AFL_HAVE_WAITERS;
+        if (__atomic_compare_exchange_n(once, &lock, AFL_LOCKED | lock, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            try {
+                std::invoke(std::forward<Callable>(f), std::forward<Args>(args)...);
+            } catch (...) {
+                if (__atomic_exchange_n(once, AFL_UNLOCKED, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS)
+                    __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+                throw;
+            }
+
+            if (__atomic_exchange_n(once, AFL_SUCCESS, __ATOMIC_RELEASE) & AFL_HAVE_WAITERS)
+                __afl_syscall(__NR_futex, (intptr_t) once, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+
+            return;
+        }
+
+        if (lock & AFL_SUCCESS)
+            return;
+
+        if (!(lock & AFL_LOCKED))
+            continue;
+
+        if ((lock & AFL_HAVE_WAITERS)
+            || __atomic_compare_exchange_n(once, &lock, lock | AFL_HAVE_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            __afl_syscall(
+              __NR_futex, (intptr_t) once, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, AFL_LOCKED | AFL_HAVE_WAITERS, 0
+            );
+
+        __atomic_load(once, &lock, __ATOMIC_ACQUIRE);
+
+        if (lock & AFL_SUCCESS)
+            return;
+    }
+}
+
+} // namespace afl
+
+#endif /* __AFL_HPP */
@@ -0,0 +1,295 @@
+#ifndef __AFL_EBR_H
+#define __AFL_EBR_H
+
+#include <linux/membarrier.h>
+
+#include "afl.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Epoch-Based Reclamation
+ *
+ * Readers of a linked structure run inside afl_ebr_enter / afl_ebr_exit instead of taking a lock,
+ * writers unlink a node and hand it to afl_ebr_retire, it is freed once every reader that could still see it left.
+ *
+ * Every thread that reads or retires registers an afl_ebr_thread_t, the record stays owned by the caller
+ * and must outlive afl_ebr_unregister. Its first word is the epoch the thread entered in with AFL_EBR_ACTIVE set,
+ * or zero while the thread is quiescent. Enter stores the global epoch and loads it again, exit stores zero:
+ * neither takes an atomic read-modify-write and sections may nest.
+ *
+ * afl_ebr_synchronize advances the global epoch and waits for every record that is active in an older epoch.
+ * It spins AFL_EBR_SPINS times per reader and then sleeps in futex on the domain, the reader that leaves
+ * its section wakes it. The reader side store-load ordering is provided by MEMBARRIER_CMD_PRIVATE_EXPEDITED
+ * (Linux 4.14), which the writer issues on behalf of all running threads, so readers only stop the compiler.
+ * When membarrier is not available readers issue a full fence on enter and exit (MFENCE / DMB ISH).
+ *
+ * Retired nodes are queued per thread with the epoch of their retirement and freed by afl_ebr_reclaim,
+ * which runs every AFL_EBR_BATCH retirements. A node is freed without waiting once two grace periods
+ * completed after it was retired, otherwise the reclaiming thread runs a grace period itself.
+ * Never call afl_ebr_synchronize, afl_ebr_reclaim or afl_ebr_unregister inside a read-side section.
+ */
+#define AFL_EBR_ACTIVE 0x1 // The thread is inside a read-side section, epochs advance by 2
+#define AFL_EBR_SPINS 128  // Spins on a reader before the grace period sleeps in futex
+#define AFL_EBR_BATCH 64   // Retired nodes per thread before afl_ebr_retire reclaims
+
+typedef struct afl_ebr_node
+{
+    struct afl_ebr_node *next;
+    void (*reclaim)(struct afl_ebr_node *node);
+    uint32_t epoch;
+} afl_ebr_node_t;
+
+typedef struct afl_ebr_thread
+{
+    uint32_t epoch; // Read by afl_ebr_synchronize, written only by the owner
+    uint32_t nest;
+    uint32_t pending;
+    struct afl_ebr_thread *next;
+    afl_ebr_node_t *head;
+    afl_ebr_node_t *tail;
+} __AFL_ALIGN afl_ebr_thread_t;
+
+typedef struct
+{
+    uint32_t epoch;
+    uint32_t completed;  // Epoch of the last finished grace period
+    uint32_t waiting;    // A grace period sleeps on this futex word
+    uint32_t membarrier; // MEMBARRIER_CMD_PRIVATE_EXPEDITED is registered
+    afl_ebr_thread_t *threads;
+    afl_mutex_t lock; // Serializes grace periods and the thread list
+} afl_ebr_t;
+
+static inline int afl_ebr_init(afl_ebr_t *ebr)
+{
+    ebr->epoch      = 0;
+    ebr->completed  = 0;
+    ebr->waiting    = 0;
+    ebr->threads    = NULL;
+    ebr->lock       = AFL_MUTEX_INIT;
+    ebr->membarrier = __afl_syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0, 0) == 0;
+
+    return 0;
+}
+
+/*
+ * Reader half of the store-load ordering, the writer half is __afl_ebr_heavy_fence.
+ */
+static inline void __afl_ebr_light_fence(afl_ebr_t *ebr)
+{
+    if (__afl_likely(ebr->membarrier))
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __afl_ebr_heavy_fence(afl_ebr_t *ebr)
+{
+    if (__afl_likely(ebr->membarrier))
+        __afl_syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0, 0);
+    else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void afl_ebr_enter(afl_ebr_t *ebr, afl_ebr_thread_t *thread)
+{
+    uint32_t epoch, current;
+
+    if (thread->nest++)
+        return;
+
+    __atomic_load(&ebr->epoch, &epoch, __ATOMIC_RELAXED);
+    for (;;) {
+        __atomic_store_n(&thread->epoch, epoch | AFL_EBR_ACTIVE, __ATOMIC_RELAXED);
+        __afl_ebr_light_fence(ebr);
+
+        /* A grace period that started before the store could have missed it, enter its epoch instead. */
+        __atomic_load(&ebr->epoch, &current, __ATOMIC_ACQUIRE);
+        if (__afl_likely(current == epoch))
+            return;
+        epoch = current;
+    }
+}
+
+static inline void afl_ebr_exit(afl_ebr_t *ebr, afl_ebr_thread_t *thread)
+{
+    __afl_debug(!thread->nest, "An attempt was made to exit an EBR section that was not entered.");
+
+    if (--thread->nest)
+        return;
+
+    __atomic_store_n(&thread->epoch, 0, __ATOMIC_RELEASE);
+    __afl_ebr_light_fence(ebr);
+
+    if (__afl_unlikely(__atomic_load_n(&ebr->waiting, __ATOMIC_RELAXED))) {
+        __atomic_store_n(&ebr->waiting, 0, __ATOMIC_RELAXED);
+        __afl_syscall(__NR_futex, (intptr_t) &ebr->waiting, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, 0);
+    }
+}
+
+static inline void afl_ebr_synchronize(afl_ebr_t *ebr)
+{
+    uint32_t epoch;
+
+    afl_mutex_lock(&ebr->lock);
+
+    epoch = ebr->epoch + 2;
+    __atomic_store_n(&ebr->epoch, epoch, __ATOMIC_RELEASE);
+    __afl_ebr_heavy_fence(ebr);
+
+    for (afl_ebr_thread_t *thread = ebr->threads; thread; thread = thread->next) {
+        uint32_t spins = 0, current;
+
+        while ((current = __atomic_load_n(&thread->epoch, __ATOMIC_ACQUIRE)) && current != (epoch | AFL_EBR_ACTIVE)) {
+            if (spins++ < AFL_EBR_SPINS) {
+                __afl_pause;
+                continue;
+            }
+
+            /* The exit of the reader either sees the flag or its store is seen by the load after the fence. */
+            __atomic_store_n(&ebr->waiting, 1, __ATOMIC_RELAXED);
+            __afl_ebr_heavy_fence(ebr);
+            current = __atomic_load_n(&thread->epoch, __ATOMIC_ACQUIRE);
+            if (current && current != (epoch | AFL_EBR_ACTIVE))
+                __afl_futex_wait_until(&ebr->waiting, 1, NULL);
+        }
+    }
+
+    __atomic_store_n(&ebr->waiting, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ebr->completed, epoch, __ATOMIC_RELEASE);
+
+    afl_mutex_unlock(&ebr->lock);
+}
+
+static inline int afl_ebr_register(afl_ebr_t *ebr, afl_ebr_thread_t *thread)
+{
+    thread->epoch   = 0;
+    thread->nest    = 0;
+    thread->pending = 0;
+    thread->head    = NULL;
+    thread->tail    = NULL;
+
+    afl_mutex_lock(&ebr->lock);
+    thread->next = ebr->threads;
+    ebr->threads = thread;
+    afl_mutex_unlock(&ebr->lock);
+
+    return 0;
+}
+
+static inline int __afl_ebr_expired(afl_ebr_t *ebr, afl_ebr_node_t *node)
+{
+    return (int32_t) (__atomic_load_n(&ebr->completed, __ATOMIC_ACQUIRE) - node->epoch) >= 4;
+}
+
+/*
+ * Free the retired nodes of the thread that no reader can reach any more.
+ * With `wait` the thread runs a grace period when the oldest node has not expired yet,
+ * after which every node retired before the call is freed.
+ * The queue is detached first, so reclaim callbacks may retire nodes again.
+ */
+static inline void __afl_ebr_reclaim(afl_ebr_t *ebr, afl_ebr_thread_t *thread, int wait)
+{
+    afl_ebr_node_t *node = thread->head, *next, *last;
+    uint32_t remaining   = 0;
+    int all              = 0;
+
+    __afl_debug(wait && thread->nest, "An attempt was made to reclaim inside an EBR section.");
+
+    if (!node)
+        return;
+
+    thread->head    = NULL;
+    thread->tail    = NULL;
+    thread->pending = 0;
+
+    if (wait && !__afl_ebr_expired(ebr, node)) {
+        afl_ebr_synchronize(ebr);
+        all = 1;
+    }
+
+    while (node && (all || __afl_ebr_expired(ebr, node))) {
+        next = node->next;
+        node->reclaim(node);
+        node = next;
+    }
+
+    if (!node)
+        return;
+
+    /* Put the nodes that have not expired back in front of the ones retired by the callbacks. */
+    for (last = node, remaining = 1; last->next; last = last->next)
+        remaining++;
+    last->next = thread->head;
+    if (!thread->tail)
+        thread->tail = last;
+    thread->head = node;
+    thread->pending += remaining;
+}
+
+static inline void afl_ebr_reclaim(afl_ebr_t *ebr, afl_ebr_thread_t *thread)
+{
+    __afl_ebr_reclaim(ebr, thread, 1);
+}
+
+/*
+ * Queue a node that was already unlinked from the shared structure, `reclaim` is called once it is unreachable.
+ * Inside a read-side section only the expired nodes are freed when the batch is full.
+ */
+static inline void afl_ebr_retire(
+  afl_ebr_t *ebr, afl_ebr_thread_t *thread, afl_ebr_node_t *node, void (*reclaim)(afl_ebr_node_t *node)
+)
+{
+    /* Order the unlink before the epoch load, the node must not be stamped with an epoch older than its readers. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    node->next    = NULL;
+    node->reclaim = reclaim;
+    node->epoch   = __atomic_load_n(&ebr->epoch, __ATOMIC_RELAXED);
+
+    if (thread->tail)
+        thread->tail->next = node;
+    else
+        thread->head = node;
+    thread->tail = node;
+
+    if (++thread->pending >= AFL_EBR_BATCH)
+        __afl_ebr_reclaim(ebr, thread, !thread->nest);
+}
+
+static inline int afl_ebr_unregister(afl_ebr_t *ebr, afl_ebr_thread_t *thread)
+{
+    afl_ebr_thread_t **link;
+
+    __afl_debug(thread->nest, "An attempt was made to unregister a thread inside an EBR section.");
+
+    afl_mutex_lock(&ebr->lock);
+    for (link = &ebr->threads; *link; link = &(*link)->next) {
+        if (*link == thread) {
+            *link = thread->next;
+            break;
+        }
+    }
+    afl_mutex_unlock(&ebr->lock);
+
+    while (thread->head)
+        afl_ebr_reclaim(ebr, thread);
+
+    return 0;
+}
+
+static inline int afl_ebr_destroy(afl_ebr_t *ebr)
+{
+    __afl_debug(ebr->threads != NULL, "An attempt was made to destroy an EBR domain with registered threads.");
+
+    return afl_mutex_destroy(&ebr->lock);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* __AFL_EBR_H */
@@ -0,0 +1,81 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 32
+#define RUN_ITERATIONS 256
+#include "benchmark.h"
+
+#define MAX_THREADS 16
+
+/*
+ * Every run starts its own OpenMP team that goes through the barrier once per iteration.
+ * The outer do_bench team has one thread, so the inner team is the only active parallel region.
+ */
+static int threads_count;
+
+static timing_t benchmark_pthread_barrier(size_t iters)
+{
+    timing_t start, stop;
+    pthread_barrier_t barrier;
+
+    pthread_barrier_init(&barrier, NULL, threads_count);
+
+    TIMING_NOW(start);
+#pragma omp parallel num_threads(threads_count)
+    for (size_t i = 0; i < iters; i++)
+        pthread_barrier_wait(&barrier);
+    TIMING_NOW(stop);
+
+    pthread_barrier_destroy(&barrier);
+
+    return stop - start;
+}
+
+static timing_t benchmark_atomic_barrier(size_t iters)
+{
+    timing_t start, stop;
+    afl_barrier_t barrier;
+
+    afl_barrier_init(&barrier, threads_count);
+
+    TIMING_NOW(start);
+#pragma omp parallel num_threads(threads_count)
+    for (size_t i = 0; i < iters; i++)
+        afl_barrier_wait(&barrier);
+    TIMING_NOW(stop);
+
+    afl_barrier_destroy(&barrier);
+
+    return stop - start;
+}
+
+int main(void)
+{
+    omp_set_num_threads(1);
+
+    for (threads_count = 2; threads_count <= MAX_THREADS; threads_count *= 2) {
+        benchmark_info pthread_barrier = {.func = benchmark_pthread_barrier};
+        benchmark_info atomic_barrier  = {.func = benchmark_atomic_barrier};
+
+        snprintf(pthread_barrier.name, sizeof(pthread_barrier.name), "pthread barrier x%d", threads_count);
+        snprintf(atomic_barrier.name, sizeof(atomic_barrier.name), "atomic barrier x%d", threads_count);
+
+        do_bench(&pthread_barrier);
+        do_bench(&atomic_barrier);
+
+        print_benchmark(atomic_barrier, pthread_barrier);
+    }
+
+    return 0;
+}
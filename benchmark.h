@@ -2,10 +2,15 @@
 #define __AFL_BENCHMARK_H
 
 #include <math.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/param.h>
+#include <sys/syscall.h>
 
 typedef uint64_t timing_t;
 
@@ -20,6 +25,18 @@ typedef uint64_t timing_t;
         (var) = (tv.tv_nsec + UINT64_C(1000000000) * tv.tv_sec); \
     })
 
+#elif defined(__aarch64__)
+
+#ifdef USE_RDTSCP
+/* The ISB keeps the counter read from being executed before the
+   previous instructions, same as RDTSCP on x86.  */
+#define TIMING_NOW(var) ({ __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(var)::"memory"); })
+#else
+/* CNTVCT_EL0 is the virtual counter, it ticks at the constant
+   frequency reported by CNTFRQ_EL0 and is readable from user space.  */
+#define TIMING_NOW(var) ({ __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(var)); })
+#endif
+
 #else
 
 #ifdef USE_RDTSCP
@@ -38,8 +55,210 @@ typedef uint64_t timing_t;
 
 #endif
 
+/*
+ * Timer calibration
+ *
+ * All results are reported in nanoseconds.
+ * The aarch64 counter frequency is architectural, the TSC frequency is measured once against CLOCK_MONOTONIC
+ * (an invariant TSC is assumed, as on every x86 CPU of the last decade).
+ */
+#define TIMING_CALIBRATION_NS 20000000
+
+static inline double timing_ns_per_tick(void)
+{
+    static double ns_per_tick;
+
+#if defined(USE_CLOCK_GETTIME)
+    ns_per_tick = 1.0;
+#elif defined(__aarch64__)
+    if (!ns_per_tick) {
+        uint64_t frequency;
+        __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+        ns_per_tick = 1e9 / (double) frequency;
+    }
+#else
+    if (!ns_per_tick) {
+        struct timespec ts_start, ts_stop;
+        timing_t start, stop;
+        uint64_t elapsed;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts_start);
+        TIMING_NOW(start);
+        do {
+            clock_gettime(CLOCK_MONOTONIC, &ts_stop);
+            elapsed = (ts_stop.tv_sec - ts_start.tv_sec) * UINT64_C(1000000000) + ts_stop.tv_nsec - ts_start.tv_nsec;
+        } while (elapsed < TIMING_CALIBRATION_NS);
+        TIMING_NOW(stop);
+
+        ns_per_tick = (double) elapsed / (double) (stop - start);
+    }
+#endif
+
+    return ns_per_tick;
+}
+
+/*
+ * Latency histograms
+ *
+ * HDR-style log-linear histogram: values below HISTOGRAM_SUB_BUCKETS have their own bucket,
+ * above that every power of two is split into HISTOGRAM_SUB_BUCKETS / 2 linear buckets,
+ * so the relative error is below 2 / HISTOGRAM_SUB_BUCKETS over the whole 64-bit range.
+ *
+ * do_bench gives every OpenMP thread its own acquire and release histogram before the runs start,
+ * recording is two shifts and an increment without allocation or atomics.
+ * TIMING_ADD_DIFF records into the acquire histogram, TIMING_ADD_RELEASE into the release histogram.
+ * Threads started by the benchmark itself record nothing.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+// Values with bit 63 set shift by 63 - HISTOGRAM_SUB_BUCKET_BITS, so that many + 1 bucket groups are used
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t max;
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+typedef struct
+{
+    histogram_t acquire;
+    histogram_t release;
+} histogram_pair_t;
+
+static __thread histogram_pair_t *histograms_current;
+
+static inline uint32_t histogram_index(uint64_t value)
+{
+    uint32_t shift;
+
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BUCKET_BITS;
+
+    return shift * HISTOGRAM_SUB_BUCKETS + (value >> shift);
+}
+
+/*
+ * Highest value that falls into the bucket.
+ */
+static inline uint64_t histogram_value(uint32_t index)
+{
+    uint32_t shift;
+
+    if (index < 2 * HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+
+    return ((uint64_t) (index - shift * HISTOGRAM_SUB_BUCKETS) << shift) + (UINT64_C(1) << shift) - 1;
+}
+
+static inline void histogram_record(histogram_t *histogram, uint64_t value, uint64_t count)
+{
+    histogram->buckets[histogram_index(value)] += count;
+    histogram->count += count;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+static inline void histogram_merge(histogram_t *to, const histogram_t *from)
+{
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        to->buckets[i] += from->buckets[i];
+    to->count += from->count;
+    if (from->max > to->max)
+        to->max = from->max;
+}
+
+static inline double histogram_percentile(const histogram_t *histogram, double percentile)
+{
+    uint64_t rank = (uint64_t) ceil(percentile / 100.0 * histogram->count), seen = 0;
+
+    if (!histogram->count)
+        return 0.0;
+    if (!rank)
+        rank = 1;
+
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+            return (double) MIN(histogram_value(i), histogram->max);
+    }
+
+    return (double) histogram->max;
+}
+
+/*
+ * Coordinated omission: a benchmark loop that stalls for a long operation does not issue the operations
+ * it would have issued meanwhile, so their latency is missing from the histogram.
+ * Like HdrHistogram copyCorrectedForCoordinatedOmission every sample longer than the expected interval
+ * between operations adds the samples value - interval, value - 2 * interval, ... down to the interval.
+ * The missing samples of a bucket are counted per target bucket, so a long stall costs O(buckets)
+ * instead of one record per missing sample.
+ */
+static inline void histogram_correct(histogram_t *corrected, const histogram_t *histogram, uint64_t interval)
+{
+    *corrected = *histogram;
+
+    if (!interval)
+        return;
+
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t count = histogram->buckets[i];
+        uint64_t value = MIN(histogram_value(i), histogram->max);
+
+        if (!count || value < 2 * interval)
+            continue;
+
+        // Missing samples are value - k * interval for k = 1 .. (value - interval) / interval
+        for (uint32_t j = histogram_index(interval); j <= histogram_index(value - interval); j++) {
+            uint64_t low  = MAX(j ? histogram_value(j - 1) + 1 : 0, interval);
+            uint64_t high = MIN(histogram_value(j), value - interval);
+            uint64_t first, last;
+
+            if (low > high)
+                continue;
+
+            first = (value - high + interval - 1) / interval;
+            last  = (value - low) / interval;
+            if (first > last)
+                continue;
+
+            corrected->buckets[j] += (last - first + 1) * count;
+            corrected->count += (last - first + 1) * count;
+        }
+    }
+}
+
 #define TIMING_DIFF(diff, start, end) ((diff) = (end) - (start))
-#define TIMING_ADD_DIFF(total, start, end) ((total) += (end) - (start))
+#define TIMING_RECORD(histogram, start, end)                                      \
+    ({                                                                            \
+        if (histograms_current)                                                   \
+            histogram_record(&histograms_current->histogram, (end) - (start), 1); \
+    })
+#define TIMING_ADD_DIFF(total, start, end)  \
+    ({                                      \
+        TIMING_RECORD(acquire, start, end); \
+        (total) += (end) - (start);         \
+    })
+#define TIMING_ADD_RELEASE(total, start, end) \
+    ({                                        \
+        TIMING_RECORD(release, start, end);   \
+        (total) += (end) - (start);           \
+    })
+
+/*
+ * Acquire latency from timestamps taken on two threads. Without synchronized TSCs the end can be read
+ * before the start, such a sample is recorded as 0 instead of wrapping around.
+ */
+#define TIMING_ADD_CROSS_DIFF(total, start, end)                  \
+    ({                                                            \
+        timing_t __cross_end = (end) < (start) ? (start) : (end); \
+        TIMING_ADD_DIFF(total, start, __cross_end);               \
+    })
 
 #ifndef RUNS_COUNT
 #error "RUNS_COUNT not defined!"
@@ -49,6 +268,20 @@ typedef uint64_t timing_t;
 #error "RUN_ITERATIONS not defined!"
 #endif
 
+/*
+ * Every benchmark is measured TRIALS_COUNT times RUNS_COUNT runs, after WARMUP_RUNS runs that fault in
+ * the stacks, train the branch predictors and let the CPU leave its idle frequency.
+ */
+#ifndef TRIALS_COUNT
+#define TRIALS_COUNT 3
+#endif
+
+#ifndef WARMUP_RUNS
+#define WARMUP_RUNS (RUNS_COUNT / 10 + 1)
+#endif
+
+#define BENCHMARK_RUNS (WARMUP_RUNS + RUNS_COUNT * TRIALS_COUNT)
+
 static inline size_t fibonacci(size_t n)
 {
     if (n <= 1)
@@ -56,67 +289,443 @@ static inline size_t fibonacci(size_t n)
     return fibonacci(n - 1) + fibonacci(n - 2);
 }
 
+/*
+ * Thread placement
+ *
+ * BENCH_AFFINITY selects where do_bench pins its OpenMP threads, thread i runs on the i-th CPU of the list:
+ *   spread  - no pinning, placement is left to OpenMP proc_bind(spread) (default)
+ *   core    - every thread on the same CPU
+ *   smt     - the SMT siblings of one core
+ *   socket  - one CPU per core, all cores on the same package
+ *   cross   - one CPU per core, alternating between packages
+ * Only CPUs in the process affinity mask are used and the list wraps around when there are more threads than CPUs,
+ * so a machine without SMT or with a single package degrades to core and socket respectively.
+ */
+#define AFFINITY_MAX_CPUS 1024
+
+typedef struct
+{
+    unsigned long bits[AFFINITY_MAX_CPUS / (8 * sizeof(unsigned long))];
+} affinity_mask_t;
+
+static inline int affinity_get(affinity_mask_t *mask)
+{
+    memset(mask, 0, sizeof(*mask));
+    return syscall(__NR_sched_getaffinity, 0, sizeof(*mask), mask) < 0 ? -1 : 0;
+}
+
+static inline int affinity_set(const affinity_mask_t *mask)
+{
+    return syscall(__NR_sched_setaffinity, 0, sizeof(*mask), mask) < 0 ? -1 : 0;
+}
+
+static inline int affinity_pin(int cpu)
+{
+    affinity_mask_t mask;
+
+    memset(&mask, 0, sizeof(mask));
+    mask.bits[cpu / (8 * sizeof(unsigned long))] |= 1UL << (cpu % (8 * sizeof(unsigned long)));
+
+    return affinity_set(&mask);
+}
+
+static inline int affinity_topology(int cpu, const char *name, int fallback)
+{
+    char path[128];
+    FILE *file;
+    int value = fallback;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    if ((file = fopen(path, "r"))) {
+        if (fscanf(file, "%d", &value) != 1)
+            value = fallback;
+        fclose(file);
+    }
+
+    return value;
+}
+
+static inline const char *affinity_mode(void)
+{
+    const char *mode = getenv("BENCH_AFFINITY");
+
+    return mode && *mode ? mode : "spread";
+}
+
+/*
+ * Fills cpus with the placement list of the current mode, returns 0 when threads are not pinned.
+ */
+static inline int affinity_cpus(int *cpus)
+{
+    static int allowed[AFFINITY_MAX_CPUS], core[AFFINITY_MAX_CPUS], package[AFFINITY_MAX_CPUS];
+    static char leader[AFFINITY_MAX_CPUS];
+    const char *mode = affinity_mode();
+    affinity_mask_t mask;
+    int n = 0, count = 0;
+
+    if (!strcmp(mode, "spread") || affinity_get(&mask))
+        return 0;
+
+    for (int cpu = 0; cpu < AFFINITY_MAX_CPUS; cpu++) {
+        if (!(mask.bits[cpu / (8 * sizeof(unsigned long))] & (1UL << (cpu % (8 * sizeof(unsigned long))))))
+            continue;
+        allowed[n] = cpu;
+        core[n]    = affinity_topology(cpu, "core_id", cpu);
+        package[n] = affinity_topology(cpu, "physical_package_id", 0);
+        leader[n]  = 1;
+        for (int i = 0; i < n; i++)
+            if (core[i] == core[n] && package[i] == package[n])
+                leader[n] = 0;
+        n++;
+    }
+
+    if (!n)
+        return 0;
+
+    if (!strcmp(mode, "core")) {
+        cpus[count++] = allowed[0];
+    } else if (!strcmp(mode, "smt")) {
+        for (int i = 0; i < n; i++)
+            if (core[i] == core[0] && package[i] == package[0])
+                cpus[count++] = allowed[i];
+    } else if (!strcmp(mode, "socket")) {
+        for (int i = 0; i < n; i++)
+            if (leader[i] && package[i] == package[0])
+                cpus[count++] = allowed[i];
+    } else if (!strcmp(mode, "cross")) {
+        /* The round-th core of every package, packages in the order they first appear. */
+        for (int round = 0, added = 1; added; round++) {
+            added = 0;
+            for (int p = 0; p < n; p++) {
+                int first = 1, seen = 0;
+
+                for (int i = 0; i < p; i++)
+                    if (package[i] == package[p])
+                        first = 0;
+                if (!first)
+                    continue;
+
+                for (int i = 0; i < n; i++) {
+                    if (!leader[i] || package[i] != package[p] || seen++ != round)
+                        continue;
+                    cpus[count++] = allowed[i];
+                    added         = 1;
+                    break;
+                }
+            }
+        }
+    } else {
+        fprintf(stderr, "BENCH_AFFINITY: unknown mode %s, expected spread, core, smt, socket or cross\n", mode);
+    }
+
+    return count;
+}
+
+/*
+ * Significance
+ *
+ * Two benchmarks differ when the two-sided Mann-Whitney U test on their per-run durations rejects equal
+ * distributions at SIGNIFICANCE_ALPHA and the bootstrap confidence interval of the ratio of the means excludes 1.
+ * The U test uses the normal approximation with tie correction, the bootstrap draws at most
+ * SIGNIFICANCE_BOOTSTRAP_SAMPLES runs per side and round, which only widens the interval.
+ */
+#define SIGNIFICANCE_ALPHA 0.05
+#define SIGNIFICANCE_BOOTSTRAP_ROUNDS 1000
+#define SIGNIFICANCE_BOOTSTRAP_SAMPLES 4096
+
+typedef struct
+{
+    double p_value;
+    double ratio_low, ratio_high;
+    int significant;
+} significance_info;
+
+typedef struct
+{
+    double value;
+    int group;
+} significance_rank_t;
+
+static inline int significance_compare_rank(const void *a, const void *b)
+{
+    double x = ((const significance_rank_t *) a)->value, y = ((const significance_rank_t *) b)->value;
+
+    return (x > y) - (x < y);
+}
+
+static inline int significance_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static inline double mann_whitney_p(const double *x, size_t nx, const double *y, size_t ny)
+{
+    size_t n                 = nx + ny;
+    significance_rank_t *all = (significance_rank_t *) malloc(n * sizeof(significance_rank_t));
+    double rank_sum = 0.0, ties = 0.0, u, sigma;
+
+    for (size_t i = 0; i < nx; i++)
+        all[i] = (significance_rank_t){x[i], 0};
+    for (size_t i = 0; i < ny; i++)
+        all[nx + i] = (significance_rank_t){y[i], 1};
+
+    qsort(all, n, sizeof(significance_rank_t), significance_compare_rank);
+
+    for (size_t i = 0, j; i < n; i = j) {
+        double rank, t;
+
+        for (j = i; j < n && all[j].value == all[i].value; j++)
+            ;
+
+        /* Tied values share the average of ranks i + 1 .. j. */
+        rank = (double) (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++)
+            if (!all[k].group)
+                rank_sum += rank;
+
+        t = (double) (j - i);
+        ties += t * t * t - t;
+    }
+
+    free(all);
+
+    u     = rank_sum - (double) nx * (nx + 1) / 2.0;
+    sigma = sqrt((double) nx * ny / 12.0 * ((n + 1) - ties / ((double) n * (n - 1))));
+
+    if (!(sigma > 0.0))
+        return 1.0;
+
+    return erfc(fabs(u - (double) nx * ny / 2.0) / sigma / sqrt(2.0));
+}
+
+static inline double bootstrap_mean(const double *x, size_t n, uint64_t *state)
+{
+    size_t m   = MIN(n, SIGNIFICANCE_BOOTSTRAP_SAMPLES);
+    double sum = 0.0;
+
+    for (size_t i = 0; i < m; i++) {
+        *state ^= *state << 13;
+        *state ^= *state >> 7;
+        *state ^= *state << 17;
+        sum += x[*state % n];
+    }
+
+    return sum / m;
+}
+
+static inline significance_info significance(const double *x, size_t nx, const double *y, size_t ny)
+{
+    significance_info info = {.p_value = 1.0, .ratio_low = NAN, .ratio_high = NAN, .significant = 0};
+    double *ratios;
+    uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+
+    if (nx < 2 || ny < 2)
+        return info;
+
+    ratios = (double *) malloc(SIGNIFICANCE_BOOTSTRAP_ROUNDS * sizeof(double));
+    for (size_t i = 0; i < SIGNIFICANCE_BOOTSTRAP_ROUNDS; i++) {
+        double mx = bootstrap_mean(x, nx, &state);
+        ratios[i] = mx / bootstrap_mean(y, ny, &state);
+    }
+    qsort(ratios, SIGNIFICANCE_BOOTSTRAP_ROUNDS, sizeof(double), significance_compare_double);
+
+    info.ratio_low   = ratios[(size_t) (SIGNIFICANCE_BOOTSTRAP_ROUNDS * SIGNIFICANCE_ALPHA / 2)];
+    info.ratio_high  = ratios[(size_t) (SIGNIFICANCE_BOOTSTRAP_ROUNDS * (1 - SIGNIFICANCE_ALPHA / 2)) - 1];
+    info.p_value     = mann_whitney_p(x, nx, y, ny);
+    info.significant = info.p_value < SIGNIFICANCE_ALPHA && (info.ratio_low > 1.0 || info.ratio_high < 1.0);
+
+    free(ratios);
+
+    return info;
+}
+
 typedef timing_t (*benchmark_function_t)(size_t);
 
+typedef struct
+{
+    double p50, p99, p999, max;
+    double p99_corrected, p999_corrected;
+    uint64_t count;
+} latency_info;
+
 typedef struct
 {
     char name[128];
     benchmark_function_t func;
     double duration;
     double mean, stdev, min, max;
+    latency_info acquire, release;
+    double *samples; /* per run iteration, RUNS_COUNT * TRIALS_COUNT */
 } benchmark_info;
 
-static int do_bench(benchmark_info *benchmark)
+static inline latency_info latency_summary(const histogram_t *histogram, double scale, uint64_t interval)
 {
-    timing_t duration = 0;
-    timing_t durations[RUNS_COUNT];
-    double mean = 0.0, stdev = 0.0, min = 0.0, max = 0.0;
+    histogram_t *corrected = (histogram_t *) malloc(sizeof(histogram_t));
+    latency_info info;
+
+    histogram_correct(corrected, histogram, interval);
+
+    info.count          = histogram->count;
+    info.p50            = scale * histogram_percentile(histogram, 50.0);
+    info.p99            = scale * histogram_percentile(histogram, 99.0);
+    info.p999           = scale * histogram_percentile(histogram, 99.9);
+    info.max            = scale * (double) histogram->max;
+    info.p99_corrected  = scale * histogram_percentile(corrected, 99.0);
+    info.p999_corrected = scale * histogram_percentile(corrected, 99.9);
+
+    free(corrected);
+
+    return info;
+}
 
-#pragma omp parallel for proc_bind(spread)
-    for (size_t i = 0; i < RUNS_COUNT; i++) {
-        durations[i] = benchmark->func(RUN_ITERATIONS);
+static inline int do_bench(benchmark_info *benchmark)
+{
+    const size_t count = (size_t) RUNS_COUNT * TRIALS_COUNT;
+    const double scale = timing_ns_per_tick();
+    double mean = 0.0, stdev = 0.0, min = INFINITY, max = 0.0;
+    int threads                  = omp_get_max_threads();
+    int *cpus                    = (int *) malloc(AFFINITY_MAX_CPUS * sizeof(int));
+    int cpus_count               = affinity_cpus(cpus);
+    timing_t *durations          = (timing_t *) malloc(count * sizeof(timing_t));
+    histogram_pair_t *histograms = (histogram_pair_t *) calloc(threads + 1, sizeof(histogram_pair_t));
+    histogram_t *runs            = (histogram_t *) calloc(1, sizeof(histogram_t));
+    uint64_t interval;
+
+#pragma omp parallel proc_bind(spread)
+    {
+        affinity_mask_t saved;
+        int pinned = cpus_count && !affinity_get(&saved) && !affinity_pin(cpus[omp_get_thread_num() % cpus_count]);
+
+#pragma omp for
+        for (size_t i = 0; i < WARMUP_RUNS; i++)
+            benchmark->func(RUN_ITERATIONS);
+
+        for (size_t trial = 0; trial < TRIALS_COUNT; trial++) {
+#pragma omp for
+            for (size_t i = 0; i < RUNS_COUNT; i++) {
+                histograms_current                = &histograms[omp_get_thread_num() + 1];
+                durations[trial * RUNS_COUNT + i] = benchmark->func(RUN_ITERATIONS);
+                histograms_current                = NULL;
+            }
+        }
+
+        if (pinned)
+            affinity_set(&saved);
     }
 
-    for (size_t i = 0; i < RUNS_COUNT; i++) {
-        mean += (double) durations[i];
-        duration += durations[i];
-        if (durations[i] > max)
-            max = durations[i];
-        else if (durations[i] < max)
-            min = durations[i];
+    benchmark->samples = (double *) realloc(benchmark->samples, count * sizeof(double));
+
+    for (size_t i = 0; i < count; i++) {
+        double sample         = scale * (double) durations[i] / RUN_ITERATIONS;
+        benchmark->samples[i] = sample;
+        histogram_record(runs, durations[i] / RUN_ITERATIONS, 1);
+        mean += sample;
+        if (sample > max)
+            max = sample;
+        if (sample < min)
+            min = sample;
     }
-    mean /= RUNS_COUNT;
+    mean /= count;
 
-    for (size_t i = 0; i < RUNS_COUNT; i++) {
-        double s = (double) durations[i] - mean;
+    for (size_t i = 0; i < count; i++) {
+        double s = benchmark->samples[i] - mean;
         stdev += s * s;
     }
-    stdev               = sqrt(stdev / (RUNS_COUNT - 1));
+    stdev               = sqrt(stdev / (count - 1));
+
+    benchmark->duration = mean * RUNS_COUNT;
+    benchmark->min      = min;
+    benchmark->max      = max;
+    benchmark->stdev    = stdev;
+    benchmark->mean     = mean;
+
+    for (int i = 1; i <= threads; i++) {
+        histogram_merge(&histograms[0].acquire, &histograms[i].acquire);
+        histogram_merge(&histograms[0].release, &histograms[i].release);
+    }
+
+    /*
+     * The expected interval between operations for the coordinated omission correction is the median timed
+     * duration of one run iteration, one acquire and one release. The untimed critical section is left out,
+     * so the interval is a lower bound and the correction errs on the large side.
+     */
+    interval = (uint64_t) histogram_percentile(runs, 50.0);
+
+    benchmark->acquire = latency_summary(&histograms[0].acquire, scale, interval);
+    benchmark->release = latency_summary(&histograms[0].release, scale, interval);
 
-    benchmark->duration = (double) duration / RUN_ITERATIONS;
-    benchmark->min      = min / RUN_ITERATIONS;
-    benchmark->max      = max / RUN_ITERATIONS;
-    benchmark->stdev    = stdev / RUN_ITERATIONS;
-    benchmark->mean     = mean / RUN_ITERATIONS;
+    free(runs);
+    free(histograms);
+    free(durations);
+    free(cpus);
 
     return 0;
 }
 
-static int print_benchmark(benchmark_info b1, benchmark_info b2)
+/*
+ * The marker shows which side is faster only when the difference is significant, [=] otherwise.
+ * Only the mean of the run durations is tested, so the other rows always print [=].
+ */
+static inline void print_row(const char *label, double v1, double v2, int significant)
 {
     const char *plus  = "\033[0;32m[+]\033[0m";
     const char *minus = "\033[0;31m[-]\033[0m";
+    const char *same  = "\033[0;37m[=]\033[0m";
+
+    printf("\t %s %17s\t %15.2f\t %15.2f\n", !significant ? same : v1 < v2 ? plus : minus, label, v1, v2);
+}
+
+static inline void print_latency(const char *title, latency_info l1, latency_info l2)
+{
+    char label[32];
+
+    if (!l1.count && !l2.count)
+        return;
+
+    printf("\t---------------------------------------------------------------\n");
+    snprintf(label, sizeof(label), "%s p50:", title);
+    print_row(label, l1.p50, l2.p50, 0);
+    snprintf(label, sizeof(label), "%s p99:", title);
+    print_row(label, l1.p99, l2.p99, 0);
+    snprintf(label, sizeof(label), "%s p99.9:", title);
+    print_row(label, l1.p999, l2.p999, 0);
+    snprintf(label, sizeof(label), "%s max:", title);
+    print_row(label, l1.max, l2.max, 0);
+    snprintf(label, sizeof(label), "%s p99 CO:", title);
+    print_row(label, l1.p99_corrected, l2.p99_corrected, 0);
+    snprintf(label, sizeof(label), "%s p99.9 CO:", title);
+    print_row(label, l1.p999_corrected, l2.p999_corrected, 0);
+}
+
+/*
+ * All values are in nanoseconds.  Durations are per run iteration and the duration row is the mean
+ * of one trial, latency percentiles are per timed operation, CO rows are corrected for coordinated omission.
+ */
+static inline int print_benchmark(benchmark_info b1, benchmark_info b2)
+{
+    const size_t count   = (size_t) RUNS_COUNT * TRIALS_COUNT;
+    significance_info si = {.p_value = 1.0, .ratio_low = NAN, .ratio_high = NAN, .significant = 0};
+
+    if (b1.samples && b2.samples)
+        si = significance(b1.samples, count, b2.samples, count);
 
     printf("\n\n");
     printf("\t\t\t       %s \t\t      %s\n", b1.name, b2.name);
     printf("\t---------------------------------------------------------------\n");
-    printf("\t %s  duration:\t %15.2f\t %15.2f\n", b1.duration < b2.duration ? plus : minus, b1.duration, b2.duration);
-    printf("\t %s      mean:\t %15.2f\t %15.2f\n", b1.mean < b2.mean ? plus : minus, b1.mean, b2.mean);
-    printf("\t %s     stdev:\t %15.2f\t %15.2f\n", b1.stdev < b2.stdev ? plus : minus, b1.stdev, b2.stdev);
-    printf("\t %s       min:\t %15.2f\t %15.2f\n", b1.min < b2.min ? plus : minus, b1.min, b2.min);
-    printf("\t %s       max:\t %15.2f\t %15.2f\n", b1.max < b2.max ? plus : minus, b1.max, b2.max);
+    print_row("duration:", b1.duration, b2.duration, si.significant);
+    print_row("mean:", b1.mean, b2.mean, si.significant);
+    print_row("stdev:", b1.stdev, b2.stdev, 0);
+    print_row("min:", b1.min, b2.min, 0);
+    print_row("max:", b1.max, b2.max, 0);
+    print_latency("acquire", b1.acquire, b2.acquire);
+    print_latency("release", b1.release, b2.release);
     printf("\t---------------------------------------------------------------\n");
-    printf("\t iterations: %d\n", RUNS_COUNT * RUN_ITERATIONS);
+    printf("\t p-value: %.4f, mean ratio %.0f%% CI: [%.3f, %.3f]\n", si.p_value, 100 * (1 - SIGNIFICANCE_ALPHA),
+           si.ratio_low, si.ratio_high);
+    printf("\t iterations: %d x %d trials, affinity: %s\n", RUNS_COUNT * RUN_ITERATIONS, TRIALS_COUNT,
+           affinity_mode());
     printf("\n\n");
 
     return 0;
@@ -4,6 +4,8 @@ echo -en "\n\n\t   \033[0;34m\033[1mSpinlock\033[0m"
 ./spinlock 2>/dev/null
 echo -en "\n\n\t   \033[0;34m\033[1mSpinlock Owner\033[0m"
 ./spinlock_owner 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mSpinlock Scaling\033[0m"
+./spinlock_scaling 2>/dev/null
 
 echo -en "\n\n\t   \033[0;34m\033[1mMutex\033[0m"
 ./mutex 2>/dev/null
@@ -11,7 +13,59 @@ echo -en "\n\n\t   \033[0;34m\033[1mMutex Owner\033[0m"
 ./mutex_owner 2>/dev/null
 echo -en "\n\n\t   \033[0;34m\033[1mMutex PI\033[0m"
 ./mutex_pi 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mMutex PI Priority Inversion\033[0m"
+./mutex_pi_inversion 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mMutex Process-Shared\033[0m"
+./mutex_pshared 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mMutex Robust\033[0m"
+./mutex_robust 2>/dev/null
 
 echo -en "\n\n\t   \033[0;34m\033[1mMutex Recursive\033[0m"
 ./mutex_recursive 2>/dev/null
 ./mutex_recursive_simple 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mReader/Writer Lock\033[0m"
+./rwlock 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mBig Reader Lock Scaling\033[0m"
+./brlock 2>/dev/null
+echo -en "\n\n\t   \033[0;34m\033[1mSequence Lock\033[0m"
+./seqlock 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mCondition Variable\033[0m"
+./cond 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mSemaphore\033[0m"
+./sem 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mEvent\033[0m"
+./event 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mBarrier\033[0m"
+./barrier 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mWait for Multiple Objects\033[0m"
+./wait_any 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mWait on Address\033[0m"
+./address 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mCohort Lock\033[0m"
+./cohort 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mPer-CPU Lock\033[0m"
+./percpu 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mEpoch-Based Reclamation\033[0m"
+./ebr 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mC++ Lock Policies\033[0m"
+./policy 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mC++ Standard Library Adapters\033[0m"
+./adapter 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mUnlock-to-Wakeup Handoff\033[0m"
+./handoff 2>/dev/null
+
+echo -en "\n\n\t   \033[0;34m\033[1mContention Matrix\033[0m\n\n"
+./matrix 2>/dev/null
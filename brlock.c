@@ -0,0 +1,107 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define TABLE_SIZE 16
+
+/*
+ * Read scaling: every reader looks up an entry of a small handle table under the shared lock,
+ * from one thread up to all processors.  Nothing writes, so any slowdown comes from the lock itself.
+ */
+static afl_brlock_t brlock;
+static afl_rwlock_t rwlock      = AFL_RWLOCK_INIT;
+static pthread_rwlock_t prwlock = PTHREAD_RWLOCK_INITIALIZER;
+static uintptr_t table[TABLE_SIZE];
+
+#define BENCHMARK_READER(name, lock, unlock)                                           \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        uint32_t shard;                                                                \
+        (void) shard;                                                                  \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            lock;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            total_sum += table[i % TABLE_SIZE];                                        \
+            TIMING_NOW(start);                                                         \
+            unlock;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_READER(brlock, afl_brlock_shared_lock(&brlock, &shard), afl_brlock_shared_unlock(&brlock, shard))
+BENCHMARK_READER(rwlock, afl_rwlock_shared_lock(&rwlock), afl_rwlock_shared_unlock(&rwlock))
+BENCHMARK_READER(pthread, pthread_rwlock_rdlock(&prwlock), pthread_rwlock_unlock(&prwlock))
+
+int main(void)
+{
+    int max_threads = omp_get_num_procs();
+
+    benchmark_info benchmarks[] = {
+      {.name = "brlock", .func = benchmark_brlock},
+      {.name = "rwlock", .func = benchmark_rwlock},
+      {.name = "pthread", .func = benchmark_pthread},
+    };
+    size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    if (afl_brlock_init(&brlock)) {
+        perror("afl_brlock_init");
+        return 1;
+    }
+
+    for (size_t i = 0; i < TABLE_SIZE; i++)
+        table[i] = i;
+
+    printf("\n\n\t mean per shared lock/unlock pair\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t threads");
+    for (size_t i = 0; i < count; i++)
+        printf("\t %10s", benchmarks[i].name);
+    printf("\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+        omp_set_num_threads(threads);
+        printf("\t %7d", threads);
+        for (size_t i = 0; i < count; i++) {
+            do_bench(&benchmarks[i]);
+            printf("\t %10.2f", benchmarks[i].mean);
+        }
+        printf("\n");
+        if (threads == max_threads)
+            break;
+    }
+
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t iterations: %d x %d trials, affinity: %s\n", RUNS_COUNT * RUN_ITERATIONS, TRIALS_COUNT, affinity_mode());
+    printf("\n\n");
+
+    afl_brlock_destroy(&brlock);
+
+    return 0;
+}
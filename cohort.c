@@ -0,0 +1,116 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 12
+#define SHARED_LINES 16
+#define SIMULATED_NODES 2
+
+/*
+ * Every critical section writes SHARED_LINES cache lines, the data a cross-node handoff has to move.
+ * The simulated benchmarks put OpenMP thread i on node i % SIMULATED_NODES, which splits a single-node machine;
+ * run with BENCH_AFFINITY=cross to place the threads of the detected benchmark on different sockets.
+ * Node handoffs count the acquisitions made by another node than the previous one.
+ */
+static afl_cohort_t cohort = AFL_COHORT_INIT;
+static afl_mutex_t am      = AFL_MUTEX_INIT;
+static pthread_mutex_t pm  = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t shared_data[SHARED_LINES][8];
+static uint32_t last_node;
+static size_t acquisitions, node_handoffs;
+
+static inline size_t critical_section(uint32_t node, size_t i)
+{
+    for (size_t line = 0; line < SHARED_LINES; line++)
+        shared_data[line][0]++;
+
+    if (node != last_node) {
+        last_node = node;
+        node_handoffs++;
+    }
+    acquisitions++;
+
+    return fibonacci(FIBONACCI_MAX_VALUE - i);
+}
+
+#define BENCHMARK_COHORT(name, node, lock, unlock)                                     \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        uint32_t self    = node;                                                       \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            lock;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            total_sum += critical_section(self, i);                                    \
+            TIMING_NOW(start);                                                         \
+            unlock;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_COHORT(
+  pthread_mutex, omp_get_thread_num() % SIMULATED_NODES, pthread_mutex_lock(&pm), pthread_mutex_unlock(&pm)
+)
+BENCHMARK_COHORT(atomic_mutex, omp_get_thread_num() % SIMULATED_NODES, afl_mutex_lock(&am), afl_mutex_unlock(&am))
+BENCHMARK_COHORT(
+  cohort_simulated, omp_get_thread_num() % SIMULATED_NODES, afl_cohort_lock_node(&cohort, self),
+  afl_cohort_unlock(&cohort)
+)
+BENCHMARK_COHORT(cohort_detected, afl_numa_node(), afl_cohort_lock(&cohort), afl_cohort_unlock(&cohort))
+
+static void bench(benchmark_info *benchmark)
+{
+    acquisitions  = 0;
+    node_handoffs = 0;
+
+    do_bench(benchmark);
+
+    printf("\t %-16s node handoffs per acquisition: %.4f\n", benchmark->name,
+           acquisitions ? (double) node_handoffs / acquisitions : 0.0);
+}
+
+int main(void)
+{
+    benchmark_info pthread_mutex    = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info atomic_mutex     = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info cohort_simulated = {.name = "cohort", .func = benchmark_cohort_simulated};
+    benchmark_info cohort_detected  = {.name = "cohort_numa", .func = benchmark_cohort_detected};
+
+    printf("\n\n\t threads: %d, simulated nodes: %d, batch: %d\n", omp_get_max_threads(), SIMULATED_NODES,
+           AFL_COHORT_BATCH);
+
+    bench(&pthread_mutex);
+    bench(&atomic_mutex);
+    bench(&cohort_simulated);
+    bench(&cohort_detected);
+
+    print_benchmark(cohort_simulated, atomic_mutex);
+    print_benchmark(cohort_simulated, pthread_mutex);
+    print_benchmark(cohort_detected, atomic_mutex);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 64
+#define RUN_ITERATIONS 16
+#include "benchmark.h"
+
+#define MAX_WAITERS 64
+
+/*
+ * Each run owns a condition variable with a fixed number of waiter threads.
+ * A round measures the time from the broadcast until every waiter has reacquired and released the mutex.
+ */
+static size_t waiters_count;
+
+typedef struct
+{
+    pthread_mutex_t pm;
+    pthread_cond_t pc;
+    afl_mutex_t am;
+    afl_cond_t ac;
+    size_t generation;
+    size_t waiting;
+    size_t woken;
+    int stop;
+} cond_context;
+
+static void wait_counter(size_t *counter, size_t value)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < value)
+        sched_yield();
+}
+
+static void *pthread_waiter(void *arg)
+{
+    cond_context *ctx = arg;
+
+    pthread_mutex_lock(&ctx->pm);
+    for (;;) {
+        size_t generation = ctx->generation;
+        __atomic_add_fetch(&ctx->waiting, 1, __ATOMIC_RELEASE);
+        while (generation == ctx->generation && !ctx->stop)
+            pthread_cond_wait(&ctx->pc, &ctx->pm);
+        if (ctx->stop)
+            break;
+        __atomic_add_fetch(&ctx->woken, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&ctx->pm);
+
+    return NULL;
+}
+
+static void *atomic_waiter(void *arg)
+{
+    cond_context *ctx = arg;
+
+    afl_mutex_lock(&ctx->am);
+    for (;;) {
+        size_t generation = ctx->generation;
+        __atomic_add_fetch(&ctx->waiting, 1, __ATOMIC_RELEASE);
+        while (generation == ctx->generation && !ctx->stop)
+            afl_cond_wait(&ctx->ac, &ctx->am);
+        if (ctx->stop)
+            break;
+        __atomic_add_fetch(&ctx->woken, 1, __ATOMIC_RELEASE);
+    }
+    afl_mutex_unlock(&ctx->am);
+
+    return NULL;
+}
+
+static timing_t benchmark_pthread_cond(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    pthread_t threads[MAX_WAITERS];
+    cond_context ctx = {.pm = PTHREAD_MUTEX_INITIALIZER, .pc = PTHREAD_COND_INITIALIZER};
+
+    for (size_t i = 0; i < waiters_count; i++)
+        pthread_create(&threads[i], NULL, pthread_waiter, &ctx);
+
+    for (size_t i = 0; i < iters; i++) {
+        wait_counter(&ctx.waiting, waiters_count * (i + 1));
+        TIMING_NOW(start);
+        pthread_mutex_lock(&ctx.pm);
+        ctx.generation++;
+        pthread_cond_broadcast(&ctx.pc);
+        pthread_mutex_unlock(&ctx.pm);
+        wait_counter(&ctx.woken, waiters_count * (i + 1));
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+    }
+
+    wait_counter(&ctx.waiting, waiters_count * (iters + 1));
+    pthread_mutex_lock(&ctx.pm);
+    ctx.stop = 1;
+    pthread_cond_broadcast(&ctx.pc);
+    pthread_mutex_unlock(&ctx.pm);
+
+    for (size_t i = 0; i < waiters_count; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&ctx.pc);
+    pthread_mutex_destroy(&ctx.pm);
+
+    fprintf(stderr, "Waiters: %zu, Duration: %.2f\n", waiters_count, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_cond(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    pthread_t threads[MAX_WAITERS];
+    cond_context ctx = {.am = AFL_MUTEX_INIT, .ac = AFL_COND_INIT};
+
+    for (size_t i = 0; i < waiters_count; i++)
+        pthread_create(&threads[i], NULL, atomic_waiter, &ctx);
+
+    for (size_t i = 0; i < iters; i++) {
+        wait_counter(&ctx.waiting, waiters_count * (i + 1));
+        TIMING_NOW(start);
+        afl_mutex_lock(&ctx.am);
+        ctx.generation++;
+        afl_cond_broadcast(&ctx.ac);
+        afl_mutex_unlock(&ctx.am);
+        wait_counter(&ctx.woken, waiters_count * (i + 1));
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+    }
+
+    wait_counter(&ctx.waiting, waiters_count * (iters + 1));
+    afl_mutex_lock(&ctx.am);
+    ctx.stop = 1;
+    afl_cond_broadcast(&ctx.ac);
+    afl_mutex_unlock(&ctx.am);
+
+    for (size_t i = 0; i < waiters_count; i++)
+        pthread_join(threads[i], NULL);
+
+    afl_cond_destroy(&ctx.ac);
+    afl_mutex_destroy(&ctx.am);
+
+    fprintf(stderr, "Waiters: %zu, Duration: %.2f\n", waiters_count, (double) duration);
+
+    return duration;
+}
+
+int main(void)
+{
+    for (waiters_count = 1; waiters_count <= MAX_WAITERS; waiters_count *= 2) {
+        benchmark_info pthread_cond = {.func = benchmark_pthread_cond};
+        benchmark_info atomic_cond  = {.func = benchmark_atomic_cond};
+
+        snprintf(pthread_cond.name, sizeof(pthread_cond.name), "pthread x%zu", waiters_count);
+        snprintf(atomic_cond.name, sizeof(atomic_cond.name), "atomic x%zu", waiters_count);
+
+        do_bench(&pthread_cond);
+        do_bench(&atomic_cond);
+
+        print_benchmark(atomic_cond, pthread_cond);
+    }
+
+    return 0;
+}
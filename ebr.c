@@ -0,0 +1,229 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+#include "afl_ebr.h"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define LIST_LENGTH 64
+#define WRITE_PERIOD_US 100
+
+/*
+ * Lookups in a sorted linked list while a writer thread replaces one node of every list each WRITE_PERIOD_US.
+ * The mutex list frees the old node under the lock, the EBR list retires it and readers only enter an epoch.
+ * Freed nodes are poisoned first, so a reader that reaches one counts a torn lookup.
+ */
+typedef struct list_node
+{
+    afl_ebr_node_t ebr;
+    struct list_node *next;
+    uint64_t key;
+    uint64_t value;
+    uint64_t check; // key + value
+} list_node_t;
+
+static list_node_t *mutex_list, *ebr_list;
+static afl_mutex_t mutex = AFL_MUTEX_INIT;
+static afl_ebr_t ebr;
+
+static __thread afl_ebr_thread_t ebr_thread;
+static __thread int ebr_registered;
+
+static size_t torn, writes, stop;
+
+static list_node_t *list_create(void)
+{
+    list_node_t *head = NULL;
+
+    for (uint64_t key = LIST_LENGTH; key > 0; key--) {
+        list_node_t *node = malloc(sizeof(list_node_t));
+        node->key         = key;
+        node->value       = 0;
+        node->check       = key;
+        node->next        = head;
+        head              = node;
+    }
+
+    return head;
+}
+
+static void list_destroy(list_node_t *head)
+{
+    while (head) {
+        list_node_t *next = head->next;
+        free(head);
+        head = next;
+    }
+}
+
+static void list_node_free(afl_ebr_node_t *node)
+{
+    ((list_node_t *) node)->check = 0;
+    free(node);
+}
+
+/*
+ * Replace the node of `key` by a copy with a new value, returns the unlinked node.
+ */
+static list_node_t *list_replace(list_node_t **head, uint64_t key, uint64_t value)
+{
+    list_node_t **link = head, *old, *node;
+
+    while ((*link)->key != key)
+        link = &(*link)->next;
+
+    old         = *link;
+    node        = malloc(sizeof(list_node_t));
+    node->key   = key;
+    node->value = value;
+    node->check = key + value;
+    node->next  = old->next;
+    __atomic_store_n(link, node, __ATOMIC_RELEASE);
+
+    return old;
+}
+
+static inline void list_lookup(list_node_t **head, uint64_t key, list_node_t *copy)
+{
+    list_node_t *node = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+
+    while (node->key != key)
+        node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+
+    copy->key   = node->key;
+    copy->value = node->value;
+    copy->check = node->check;
+}
+
+static void *writer(void *arg)
+{
+    afl_ebr_thread_t thread;
+
+    (void) arg;
+
+    afl_ebr_register(&ebr, &thread);
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        uint64_t key = writes % LIST_LENGTH + 1;
+
+        afl_mutex_lock(&mutex);
+        free(list_replace(&mutex_list, key, writes));
+        afl_mutex_unlock(&mutex);
+
+        afl_ebr_retire(&ebr, &thread, &list_replace(&ebr_list, key, writes)->ebr, list_node_free);
+
+        writes++;
+        usleep(WRITE_PERIOD_US);
+    }
+
+    afl_ebr_unregister(&ebr, &thread);
+
+    return NULL;
+}
+
+#define BENCHMARK_LOOKUP(name, lookup)                                                 \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        list_node_t copy;                                                              \
+                                                                                       \
+        if (!ebr_registered)                                                           \
+            ebr_registered = !afl_ebr_register(&ebr, &ebr_thread);                     \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            uint64_t key = (i * 13 + omp_get_thread_num()) % LIST_LENGTH + 1;          \
+            TIMING_NOW(start);                                                         \
+            lookup;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            if (copy.key + copy.value != copy.check)                                   \
+                __atomic_add_fetch(&torn, 1, __ATOMIC_RELAXED);                        \
+            total_sum += copy.value;                                                   \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_LOOKUP(mutex, ({
+                     afl_mutex_lock(&mutex);
+                     list_lookup(&mutex_list, key, &copy);
+                     afl_mutex_unlock(&mutex);
+                 }))
+BENCHMARK_LOOKUP(ebr, ({
+                     afl_ebr_enter(&ebr, &ebr_thread);
+                     list_lookup(&ebr_list, key, &copy);
+                     afl_ebr_exit(&ebr, &ebr_thread);
+                 }))
+
+int main(void)
+{
+    int max_threads = omp_get_num_procs();
+    pthread_t thread;
+
+    benchmark_info benchmarks[] = {
+      {.name = "mutex", .func = benchmark_mutex},
+      {.name = "ebr", .func = benchmark_ebr},
+    };
+    size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    afl_ebr_init(&ebr);
+    mutex_list = list_create();
+    ebr_list   = list_create();
+
+    pthread_create(&thread, NULL, writer, NULL);
+
+    printf("\n\n\t mean per lookup, %d nodes, writer period %d us\n", LIST_LENGTH, WRITE_PERIOD_US);
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t threads");
+    for (size_t i = 0; i < count; i++)
+        printf("\t %10s", benchmarks[i].name);
+    printf("\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+        omp_set_num_threads(threads);
+        printf("\t %7d", threads);
+        for (size_t i = 0; i < count; i++) {
+            do_bench(&benchmarks[i]);
+            printf("\t %10.2f", benchmarks[i].mean);
+        }
+        printf("\n");
+        if (threads == max_threads)
+            break;
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+
+#pragma omp parallel
+    if (ebr_registered)
+        ebr_registered = afl_ebr_unregister(&ebr, &ebr_thread);
+
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t iterations: %d x %d trials, affinity: %s\n", RUNS_COUNT * RUN_ITERATIONS, TRIALS_COUNT, affinity_mode());
+    printf("\t writes: %zu, torn lookups: %zu, membarrier: %s\n", writes, torn, ebr.membarrier ? "yes" : "no");
+    printf("\n\n");
+
+    list_destroy(mutex_list);
+    list_destroy(ebr_list);
+    afl_ebr_destroy(&ebr);
+
+    return 0;
+}
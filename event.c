@@ -0,0 +1,161 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 16
+#define RUN_ITERATIONS 32
+#include "benchmark.h"
+
+#define PARK_DELAY_US 100
+
+/*
+ * Auto-reset event emulated with a mutex and a condition variable, the way Wine does it without afl_event_t.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int signaled;
+} pthread_event_t;
+
+static void pthread_event_wait(pthread_event_t *event)
+{
+    pthread_mutex_lock(&event->mutex);
+    while (!event->signaled)
+        pthread_cond_wait(&event->cond, &event->mutex);
+    event->signaled = 0;
+    pthread_mutex_unlock(&event->mutex);
+}
+
+static void pthread_event_set(pthread_event_t *event)
+{
+    pthread_mutex_lock(&event->mutex);
+    event->signaled = 1;
+    pthread_cond_signal(&event->cond);
+    pthread_mutex_unlock(&event->mutex);
+}
+
+/*
+ * The waiter announces itself and blocks on the event, the signaler waits until it is parked in futex.
+ * A round measures the time from the set until the waiter returns from the wait.
+ */
+typedef struct
+{
+    pthread_event_t pe;
+    afl_event_t ae;
+    timing_t woken;
+    size_t waiting;
+    size_t done;
+    size_t count;
+} event_context;
+
+static void wait_counter(size_t *counter, size_t value)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < value)
+        sched_yield();
+}
+
+static void *pthread_waiter(void *arg)
+{
+    event_context *ctx = arg;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        __atomic_add_fetch(&ctx->waiting, 1, __ATOMIC_RELEASE);
+        pthread_event_wait(&ctx->pe);
+        TIMING_NOW(ctx->woken);
+        __atomic_add_fetch(&ctx->done, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static void *atomic_waiter(void *arg)
+{
+    event_context *ctx = arg;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        __atomic_add_fetch(&ctx->waiting, 1, __ATOMIC_RELEASE);
+        afl_event_wait(&ctx->ae);
+        TIMING_NOW(ctx->woken);
+        __atomic_add_fetch(&ctx->done, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static timing_t benchmark_pthread_event(size_t iters)
+{
+    timing_t start, duration = 0;
+    pthread_t thread;
+    event_context ctx = {.pe = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0}, .count = iters};
+
+    pthread_create(&thread, NULL, pthread_waiter, &ctx);
+
+    for (size_t i = 0; i < iters; i++) {
+        wait_counter(&ctx.waiting, i + 1);
+        usleep(PARK_DELAY_US);
+        TIMING_NOW(start);
+        pthread_event_set(&ctx.pe);
+        wait_counter(&ctx.done, i + 1);
+        TIMING_ADD_CROSS_DIFF(duration, start, ctx.woken);
+    }
+
+    pthread_join(thread, NULL);
+
+    pthread_cond_destroy(&ctx.pe.cond);
+    pthread_mutex_destroy(&ctx.pe.mutex);
+
+    fprintf(stderr, "Duration: %.2f\n", (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_event(size_t iters)
+{
+    timing_t start, duration = 0;
+    pthread_t thread;
+    event_context ctx = {.ae = AFL_EVENT_INIT(0, 0), .count = iters};
+
+    pthread_create(&thread, NULL, atomic_waiter, &ctx);
+
+    for (size_t i = 0; i < iters; i++) {
+        wait_counter(&ctx.waiting, i + 1);
+        usleep(PARK_DELAY_US);
+        TIMING_NOW(start);
+        afl_event_set(&ctx.ae);
+        wait_counter(&ctx.done, i + 1);
+        TIMING_ADD_CROSS_DIFF(duration, start, ctx.woken);
+    }
+
+    pthread_join(thread, NULL);
+
+    afl_event_destroy(&ctx.ae);
+
+    fprintf(stderr, "Duration: %.2f\n", (double) duration);
+
+    return duration;
+}
+
+int main(void)
+{
+    benchmark_info pthread_event = {.name = "mutex + cond", .func = benchmark_pthread_event};
+    benchmark_info atomic_event  = {.name = "atomic", .func = benchmark_atomic_event};
+
+    do_bench(&pthread_event);
+    do_bench(&atomic_event);
+
+    print_benchmark(atomic_event, pthread_event);
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 16
+#define RUN_ITERATIONS 32
+#include "benchmark.h"
+
+#define PARK_DELAY_US 100
+
+/*
+ * Unlock-to-wakeup handoff: the main thread holds the lock while the waiter blocks on it,
+ * once the waiter had time to park in futex the lock is released.
+ * A round measures the time from the release until the waiter returns from the lock call,
+ * so the acquire latency rows are the handoff latency distribution.
+ * The two timestamps come from different threads, a negative difference is recorded as 0.
+ */
+typedef struct
+{
+    pthread_mutex_t pm;
+    pthread_mutex_t ppm;
+    pthread_mutex_t prm;
+    pthread_once_t po;
+    afl_mutex_t am;
+    afl_mutex_t aom;
+    afl_mutex_t apm;
+    afl_mutex_recursive_t arm;
+    afl_once_t ao;
+    timing_t start;
+    timing_t woken;
+    size_t ready;
+    size_t waiting;
+    size_t done;
+    size_t count;
+} handoff_context;
+
+static __thread handoff_context *once_context;
+
+static void handoff_init(handoff_context *c, size_t iters)
+{
+    pthread_mutexattr_t attr;
+
+    memset(c, 0, sizeof(*c));
+    c->count = iters;
+
+    pthread_mutex_init(&c->pm, NULL);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&c->ppm, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&c->prm, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    c->am  = AFL_MUTEX_INIT;
+    c->aom = AFL_MUTEX_INIT;
+    c->apm = AFL_MUTEX_INIT;
+    afl_mutex_recursive_init(&c->arm);
+}
+
+static void handoff_destroy(handoff_context *c)
+{
+    pthread_mutex_destroy(&c->pm);
+    pthread_mutex_destroy(&c->ppm);
+    pthread_mutex_destroy(&c->prm);
+    afl_mutex_destroy(&c->am);
+    afl_mutex_destroy(&c->aom);
+    afl_mutex_destroy(&c->apm);
+    afl_mutex_recursive_destroy(&c->arm);
+}
+
+static void wait_counter(size_t *counter, size_t value)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < value)
+        sched_yield();
+}
+
+#define BENCHMARK_HANDOFF(name, lock, unlock)                         \
+    static void *name##_waiter(void *arg)                             \
+    {                                                                 \
+        handoff_context *c = arg;                                     \
+                                                                      \
+        for (size_t i = 0; i < c->count; i++) {                       \
+            wait_counter(&c->ready, i + 1);                           \
+            __atomic_add_fetch(&c->waiting, 1, __ATOMIC_RELEASE);     \
+            lock;                                                     \
+            TIMING_NOW(c->woken);                                     \
+            unlock;                                                   \
+            __atomic_add_fetch(&c->done, 1, __ATOMIC_RELEASE);        \
+        }                                                             \
+                                                                      \
+        return NULL;                                                  \
+    }                                                                 \
+                                                                      \
+    static timing_t benchmark_##name(size_t iters)                    \
+    {                                                                 \
+        timing_t duration = 0;                                        \
+        pthread_t thread;                                             \
+        handoff_context ctx, *c = &ctx;                               \
+                                                                      \
+        handoff_init(c, iters);                                       \
+        pthread_create(&thread, NULL, name##_waiter, c);              \
+                                                                      \
+        for (size_t i = 0; i < iters; i++) {                          \
+            lock;                                                     \
+            __atomic_store_n(&c->ready, i + 1, __ATOMIC_RELEASE);     \
+            wait_counter(&c->waiting, i + 1);                         \
+            usleep(PARK_DELAY_US);                                    \
+            TIMING_NOW(c->start);                                     \
+            unlock;                                                   \
+            wait_counter(&c->done, i + 1);                            \
+            TIMING_ADD_CROSS_DIFF(duration, c->start, c->woken);      \
+        }                                                             \
+                                                                      \
+        pthread_join(thread, NULL);                                   \
+        handoff_destroy(c);                                           \
+                                                                      \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);       \
+                                                                      \
+        return duration;                                              \
+    }
+
+BENCHMARK_HANDOFF(pthread_mutex, pthread_mutex_lock(&c->pm), pthread_mutex_unlock(&c->pm))
+BENCHMARK_HANDOFF(pthread_pi_mutex, pthread_mutex_lock(&c->ppm), pthread_mutex_unlock(&c->ppm))
+BENCHMARK_HANDOFF(pthread_recursive_mutex, pthread_mutex_lock(&c->prm), pthread_mutex_unlock(&c->prm))
+BENCHMARK_HANDOFF(atomic_mutex, afl_mutex_lock(&c->am), afl_mutex_unlock(&c->am))
+BENCHMARK_HANDOFF(atomic_owner_mutex, afl_mutex_owner_lock(&c->aom), afl_mutex_owner_unlock(&c->aom))
+BENCHMARK_HANDOFF(atomic_pi_mutex, afl_mutex_pi_lock(&c->apm), afl_mutex_pi_unlock(&c->apm))
+BENCHMARK_HANDOFF(atomic_recursive_mutex, afl_mutex_recursive_lock(&c->arm), afl_mutex_recursive_unlock(&c->arm))
+
+/*
+ * For once the main thread runs the init function and the waiter blocks in the once call,
+ * the round measures the time from the end of the init function until the waiter returns.
+ */
+static void once_init(void)
+{
+    handoff_context *c = once_context;
+
+    __atomic_add_fetch(&c->ready, 1, __ATOMIC_RELEASE);
+    wait_counter(&c->waiting, c->ready);
+    usleep(PARK_DELAY_US);
+    TIMING_NOW(c->start);
+}
+
+#define BENCHMARK_HANDOFF_ONCE(name, reset, once)                     \
+    static void *name##_waiter(void *arg)                             \
+    {                                                                 \
+        handoff_context *c = arg;                                     \
+                                                                      \
+        for (size_t i = 0; i < c->count; i++) {                       \
+            wait_counter(&c->ready, i + 1);                           \
+            __atomic_add_fetch(&c->waiting, 1, __ATOMIC_RELEASE);     \
+            once;                                                     \
+            TIMING_NOW(c->woken);                                     \
+            __atomic_add_fetch(&c->done, 1, __ATOMIC_RELEASE);        \
+        }                                                             \
+                                                                      \
+        return NULL;                                                  \
+    }                                                                 \
+                                                                      \
+    static timing_t benchmark_##name(size_t iters)                    \
+    {                                                                 \
+        timing_t duration = 0;                                        \
+        pthread_t thread;                                             \
+        handoff_context ctx, *c = &ctx;                               \
+                                                                      \
+        handoff_init(c, iters);                                       \
+        once_context = c;                                             \
+        pthread_create(&thread, NULL, name##_waiter, c);              \
+                                                                      \
+        for (size_t i = 0; i < iters; i++) {                          \
+            reset;                                                    \
+            once;                                                     \
+            wait_counter(&c->done, i + 1);                            \
+            TIMING_ADD_CROSS_DIFF(duration, c->start, c->woken);      \
+        }                                                             \
+                                                                      \
+        pthread_join(thread, NULL);                                   \
+        handoff_destroy(c);                                           \
+                                                                      \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);       \
+                                                                      \
+        return duration;                                              \
+    }
+
+BENCHMARK_HANDOFF_ONCE(pthread_once, c->po = (pthread_once_t) PTHREAD_ONCE_INIT, pthread_once(&c->po, once_init))
+BENCHMARK_HANDOFF_ONCE(atomic_once, c->ao = AFL_ONCE_INIT, afl_once(&c->ao, once_init))
+
+int main(void)
+{
+    benchmark_info pthread_mutex           = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info pthread_pi_mutex        = {.name = "pthread_pi", .func = benchmark_pthread_pi_mutex};
+    benchmark_info pthread_recursive_mutex = {.name = "pthread_recursive", .func = benchmark_pthread_recursive_mutex};
+    benchmark_info pthread_once_init       = {.name = "pthread_once", .func = benchmark_pthread_once};
+    benchmark_info atomic_mutex            = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info atomic_owner_mutex      = {.name = "atomic_owner", .func = benchmark_atomic_owner_mutex};
+    benchmark_info atomic_pi_mutex         = {.name = "atomic_pi", .func = benchmark_atomic_pi_mutex};
+    benchmark_info atomic_recursive_mutex  = {.name = "atomic_recursive", .func = benchmark_atomic_recursive_mutex};
+    benchmark_info atomic_once_init        = {.name = "atomic_once", .func = benchmark_atomic_once};
+
+    do_bench(&pthread_mutex);
+    do_bench(&pthread_pi_mutex);
+    do_bench(&pthread_recursive_mutex);
+    do_bench(&pthread_once_init);
+    do_bench(&atomic_mutex);
+    do_bench(&atomic_owner_mutex);
+    do_bench(&atomic_pi_mutex);
+    do_bench(&atomic_recursive_mutex);
+    do_bench(&atomic_once_init);
+
+    print_benchmark(atomic_mutex, pthread_mutex);
+    print_benchmark(atomic_owner_mutex, pthread_mutex);
+    print_benchmark(atomic_pi_mutex, pthread_pi_mutex);
+    print_benchmark(atomic_recursive_mutex, pthread_recursive_mutex);
+    print_benchmark(atomic_once_init, pthread_once_init);
+
+    return 0;
+}
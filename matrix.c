@@ -0,0 +1,832 @@
+#define AFL_COUNT_SYSCALLS
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <linux/futex.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+/*
+ * Contention matrix: every primitive runs for a fixed time in every combination of thread count,
+ * critical section length, non-critical section length and, for reader/writer locks, write percentage.
+ * Section lengths are iterations of an empty loop the compiler cannot remove.
+ *
+ * ./matrix --threads 1,2,4,8 --critical 0,100,1000 --noncritical 0,100 --writes 0,10,50 --duration 100
+ *          --primitives afl_mutex,pthread_mutex --format table|csv|json --output results.csv
+ */
+#define MAX_THREADS 256
+#define MAX_VALUES 32
+#define STOP_CHECK_PERIOD 64
+
+typedef struct
+{
+    uint64_t ops;
+    uint64_t seed;
+    afl_spin_mcs_node_t node;
+} __AFL_ALIGN thread_state;
+
+typedef struct
+{
+    const char *name;
+    int rw;     // Has a shared mode
+    int afl;    // Makes its syscalls through afl.h, so AFL_COUNT_SYSCALLS sees them
+    size_t size;
+    void (*init)(void *lock);
+    void (*lock)(void *lock, thread_state *thread);
+    void (*unlock)(void *lock, thread_state *thread);
+    void (*shared_lock)(void *lock, thread_state *thread);
+    void (*shared_unlock)(void *lock, thread_state *thread);
+    void (*destroy)(void *lock);
+} primitive;
+
+/*
+ * pthread
+ */
+static void pthread_mutex_init_wrapper(void *lock)
+{
+    pthread_mutex_init(lock, NULL);
+}
+
+static void pthread_mutex_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_mutex_lock(lock);
+}
+
+static void pthread_mutex_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_mutex_unlock(lock);
+}
+
+static void pthread_mutex_destroy_wrapper(void *lock)
+{
+    pthread_mutex_destroy(lock);
+}
+
+static void pthread_mutex_adaptive_init_wrapper(void *lock)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+    pthread_mutex_init(lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void pthread_spin_init_wrapper(void *lock)
+{
+    pthread_spin_init(lock, PTHREAD_PROCESS_PRIVATE);
+}
+
+static void pthread_spin_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_spin_lock(lock);
+}
+
+static void pthread_spin_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_spin_unlock(lock);
+}
+
+static void pthread_spin_destroy_wrapper(void *lock)
+{
+    pthread_spin_destroy(lock);
+}
+
+static void pthread_rwlock_init_wrapper(void *lock)
+{
+    pthread_rwlock_init(lock, NULL);
+}
+
+static void pthread_rwlock_wrlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_rwlock_wrlock(lock);
+}
+
+static void pthread_rwlock_rdlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_rwlock_rdlock(lock);
+}
+
+static void pthread_rwlock_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    pthread_rwlock_unlock(lock);
+}
+
+static void pthread_rwlock_destroy_wrapper(void *lock)
+{
+    pthread_rwlock_destroy(lock);
+}
+
+/*
+ * afl
+ */
+static void afl_mutex_init_wrapper(void *lock)
+{
+    *(afl_mutex_t *) lock = AFL_MUTEX_INIT;
+}
+
+static void afl_mutex_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_lock(lock);
+}
+
+static void afl_mutex_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_unlock(lock);
+}
+
+static void afl_mutex_destroy_wrapper(void *lock)
+{
+    afl_mutex_destroy(lock);
+}
+
+static void afl_mutex_owner_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_owner_lock(lock);
+}
+
+static void afl_mutex_owner_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_owner_unlock(lock);
+}
+
+static void afl_mutex_pi_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_pi_lock(lock);
+}
+
+static void afl_mutex_pi_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_pi_unlock(lock);
+}
+
+static void afl_mutex_adaptive_init_wrapper(void *lock)
+{
+    afl_mutex_adaptive_init(lock);
+}
+
+static void afl_mutex_adaptive_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_adaptive_lock(lock);
+}
+
+static void afl_mutex_adaptive_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_adaptive_unlock(lock);
+}
+
+static void afl_mutex_adaptive_destroy_wrapper(void *lock)
+{
+    afl_mutex_adaptive_destroy(lock);
+}
+
+static void afl_mutex_recursive_init_wrapper(void *lock)
+{
+    afl_mutex_recursive_init(lock);
+}
+
+static void afl_mutex_recursive_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_recursive_lock(lock);
+}
+
+static void afl_mutex_recursive_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_mutex_recursive_unlock(lock);
+}
+
+static void afl_mutex_recursive_destroy_wrapper(void *lock)
+{
+    afl_mutex_recursive_destroy(lock);
+}
+
+static void afl_spin_init_wrapper(void *lock)
+{
+    afl_spin_init(lock, 0);
+}
+
+static void afl_spin_exchange_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_exchange_lock(lock);
+}
+
+static void afl_spin_exchange_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_exchange_unlock(lock);
+}
+
+static void afl_spin_ttas_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_ttas_lock(lock);
+}
+
+static void afl_spin_ttas_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_ttas_unlock(lock);
+}
+
+static void afl_spin_ticket_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_ticket_lock(lock);
+}
+
+static void afl_spin_ticket_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_spin_ticket_unlock(lock);
+}
+
+static void afl_spin_destroy_wrapper(void *lock)
+{
+    afl_spin_destroy(lock);
+}
+
+static void afl_spin_mcs_init_wrapper(void *lock)
+{
+    afl_spin_mcs_init(lock);
+}
+
+static void afl_spin_mcs_lock_wrapper(void *lock, thread_state *thread)
+{
+    afl_spin_mcs_lock(lock, &thread->node);
+}
+
+static void afl_spin_mcs_unlock_wrapper(void *lock, thread_state *thread)
+{
+    afl_spin_mcs_unlock(lock, &thread->node);
+}
+
+static void afl_spin_mcs_destroy_wrapper(void *lock)
+{
+    afl_spin_mcs_destroy(lock);
+}
+
+static void afl_rwlock_init_wrapper(void *lock)
+{
+    afl_rwlock_init(lock);
+}
+
+static void afl_rwlock_exclusive_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_rwlock_exclusive_lock(lock);
+}
+
+static void afl_rwlock_exclusive_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_rwlock_exclusive_unlock(lock);
+}
+
+static void afl_rwlock_shared_lock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_rwlock_shared_lock(lock);
+}
+
+static void afl_rwlock_shared_unlock_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_rwlock_shared_unlock(lock);
+}
+
+static void afl_rwlock_destroy_wrapper(void *lock)
+{
+    afl_rwlock_destroy(lock);
+}
+
+static void afl_sem_init_wrapper(void *lock)
+{
+    afl_sem_init(lock, 1);
+}
+
+static void afl_sem_wait_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_sem_wait(lock);
+}
+
+static void afl_sem_post_wrapper(void *lock, thread_state *thread)
+{
+    (void) thread;
+    afl_sem_post(lock);
+}
+
+static void afl_sem_destroy_wrapper(void *lock)
+{
+    afl_sem_destroy(lock);
+}
+
+#define EXCLUSIVE(name, afl, type, init, lock, unlock, destroy)          \
+    {                                                                    \
+        name, 0, afl, sizeof(type), init, lock, unlock, NULL, NULL, destroy \
+    }
+
+static const primitive primitives[] = {
+  EXCLUSIVE(
+    "pthread_mutex", 0, pthread_mutex_t, pthread_mutex_init_wrapper, pthread_mutex_lock_wrapper,
+    pthread_mutex_unlock_wrapper, pthread_mutex_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "pthread_mutex_adaptive", 0, pthread_mutex_t, pthread_mutex_adaptive_init_wrapper, pthread_mutex_lock_wrapper,
+    pthread_mutex_unlock_wrapper, pthread_mutex_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "pthread_spin", 0, pthread_spinlock_t, pthread_spin_init_wrapper, pthread_spin_lock_wrapper,
+    pthread_spin_unlock_wrapper, pthread_spin_destroy_wrapper
+  ),
+  {"pthread_rwlock", 1, 0, sizeof(pthread_rwlock_t), pthread_rwlock_init_wrapper, pthread_rwlock_wrlock_wrapper,
+   pthread_rwlock_unlock_wrapper, pthread_rwlock_rdlock_wrapper, pthread_rwlock_unlock_wrapper,
+   pthread_rwlock_destroy_wrapper},
+  EXCLUSIVE(
+    "afl_mutex", 1, afl_mutex_t, afl_mutex_init_wrapper, afl_mutex_lock_wrapper, afl_mutex_unlock_wrapper,
+    afl_mutex_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_mutex_owner", 1, afl_mutex_t, afl_mutex_init_wrapper, afl_mutex_owner_lock_wrapper,
+    afl_mutex_owner_unlock_wrapper, afl_mutex_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_mutex_pi", 1, afl_mutex_t, afl_mutex_init_wrapper, afl_mutex_pi_lock_wrapper, afl_mutex_pi_unlock_wrapper,
+    afl_mutex_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_mutex_adaptive", 1, afl_mutex_adaptive_t, afl_mutex_adaptive_init_wrapper, afl_mutex_adaptive_lock_wrapper,
+    afl_mutex_adaptive_unlock_wrapper, afl_mutex_adaptive_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_mutex_recursive", 1, afl_mutex_recursive_t, afl_mutex_recursive_init_wrapper,
+    afl_mutex_recursive_lock_wrapper, afl_mutex_recursive_unlock_wrapper, afl_mutex_recursive_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_spin_exchange", 1, afl_spinlock_t, afl_spin_init_wrapper, afl_spin_exchange_lock_wrapper,
+    afl_spin_exchange_unlock_wrapper, afl_spin_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_spin_ttas", 1, afl_spinlock_t, afl_spin_init_wrapper, afl_spin_ttas_lock_wrapper,
+    afl_spin_ttas_unlock_wrapper, afl_spin_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_spin_ticket", 1, afl_spinlock_t, afl_spin_init_wrapper, afl_spin_ticket_lock_wrapper,
+    afl_spin_ticket_unlock_wrapper, afl_spin_destroy_wrapper
+  ),
+  EXCLUSIVE(
+    "afl_spin_mcs", 1, afl_spin_mcs_t, afl_spin_mcs_init_wrapper, afl_spin_mcs_lock_wrapper,
+    afl_spin_mcs_unlock_wrapper, afl_spin_mcs_destroy_wrapper
+  ),
+  {"afl_rwlock", 1, 1, sizeof(afl_rwlock_t), afl_rwlock_init_wrapper, afl_rwlock_exclusive_lock_wrapper,
+   afl_rwlock_exclusive_unlock_wrapper, afl_rwlock_shared_lock_wrapper, afl_rwlock_shared_unlock_wrapper,
+   afl_rwlock_destroy_wrapper},
+  EXCLUSIVE(
+    "afl_sem", 1, afl_sem_t, afl_sem_init_wrapper, afl_sem_wait_wrapper, afl_sem_post_wrapper,
+    afl_sem_destroy_wrapper
+  ),
+};
+
+#define PRIMITIVES_COUNT (sizeof(primitives) / sizeof(primitives[0]))
+
+/*
+ * One cell of the matrix
+ */
+typedef struct
+{
+    const primitive *primitive;
+    void *lock;
+    uint32_t threads;
+    uint32_t critical;
+    uint32_t noncritical;
+    uint32_t writes; // Percent of exclusive acquisitions
+    uint32_t duration_ms;
+    uint32_t ready;
+    uint32_t stop;
+    uint64_t counter;
+    uint64_t shared_counter;
+    thread_state state[MAX_THREADS];
+} run_context;
+
+typedef struct
+{
+    double seconds;
+    uint64_t ops;
+    double throughput;
+    double fairness;
+    double syscalls_per_op;
+    double switches_per_op;
+    int valid;
+} run_result;
+
+typedef struct
+{
+    run_context *ctx;
+    uint32_t index;
+} thread_arg;
+
+static inline void work(uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+        __afl_memory_barrier;
+}
+
+static inline uint64_t xorshift(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void *worker(void *arg)
+{
+    run_context *ctx        = ((thread_arg *) arg)->ctx;
+    thread_state *state     = &ctx->state[((thread_arg *) arg)->index];
+    const primitive *p      = ctx->primitive;
+    int shared              = p->rw && ctx->writes < 100;
+    uint64_t ops            = 0;
+
+    __atomic_add_fetch(&ctx->ready, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&ctx->ready, __ATOMIC_ACQUIRE) <= ctx->threads)
+        __afl_pause;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED)) {
+        for (uint32_t i = 0; i < STOP_CHECK_PERIOD; i++) {
+            if (shared && xorshift(&state->seed) % 100 >= ctx->writes) {
+                p->shared_lock(ctx->lock, state);
+                work(ctx->critical);
+                __atomic_add_fetch(&ctx->shared_counter, 1, __ATOMIC_RELAXED);
+                p->shared_unlock(ctx->lock, state);
+            } else {
+                p->lock(ctx->lock, state);
+                ctx->counter++;
+                work(ctx->critical);
+                p->unlock(ctx->lock, state);
+            }
+            ops++;
+            work(ctx->noncritical);
+        }
+    }
+
+    state->ops = ops;
+
+    return NULL;
+}
+
+static uint64_t context_switches(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static run_result run(run_context *ctx)
+{
+    pthread_t threads[MAX_THREADS];
+    thread_arg args[MAX_THREADS];
+    run_result result = {0};
+    uint64_t start, stop, syscalls, switches;
+    double sum = 0.0, sum_squares = 0.0;
+
+    ctx->lock           = aligned_alloc(64, (ctx->primitive->size + 63) & ~(size_t) 63);
+    ctx->ready          = 0;
+    ctx->stop           = 0;
+    ctx->counter        = 0;
+    ctx->shared_counter = 0;
+    ctx->primitive->init(ctx->lock);
+
+    for (uint32_t i = 0; i < ctx->threads; i++) {
+        ctx->state[i].ops  = 0;
+        ctx->state[i].seed = 0x9E3779B97F4A7C15 * (i + 1);
+        args[i].ctx        = ctx;
+        args[i].index      = i;
+        pthread_create(&threads[i], NULL, worker, &args[i]);
+    }
+
+    while (__atomic_load_n(&ctx->ready, __ATOMIC_ACQUIRE) < ctx->threads)
+        sched_yield();
+
+    syscalls = afl_syscalls_count();
+    switches = context_switches();
+    start    = now_ns();
+    __atomic_add_fetch(&ctx->ready, 1, __ATOMIC_RELEASE);
+
+    usleep(ctx->duration_ms * 1000);
+    __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < ctx->threads; i++)
+        pthread_join(threads[i], NULL);
+
+    stop     = now_ns();
+    syscalls = afl_syscalls_count() - syscalls;
+    switches = context_switches() - switches;
+
+    for (uint32_t i = 0; i < ctx->threads; i++) {
+        result.ops += ctx->state[i].ops;
+        sum += (double) ctx->state[i].ops;
+        sum_squares += (double) ctx->state[i].ops * ctx->state[i].ops;
+    }
+
+    result.seconds         = (stop - start) / 1e9;
+    result.throughput      = result.ops / result.seconds;
+    result.fairness        = sum_squares > 0.0 ? sum * sum / (ctx->threads * sum_squares) : 0.0;
+    result.syscalls_per_op = ctx->primitive->afl && result.ops ? (double) syscalls / result.ops : NAN;
+    result.switches_per_op = result.ops ? (double) switches / result.ops : NAN;
+    result.valid           = ctx->counter + ctx->shared_counter == result.ops;
+
+    ctx->primitive->destroy(ctx->lock);
+    free(ctx->lock);
+
+    return result;
+}
+
+/*
+ * Output
+ */
+enum output_format
+{
+    FORMAT_TABLE,
+    FORMAT_CSV,
+    FORMAT_JSON
+};
+
+static void print_header(FILE *file, enum output_format format)
+{
+    switch (format) {
+    case FORMAT_TABLE:
+        fprintf(
+          file, "%-24s %7s %8s %11s %6s %14s %8s %12s %12s\n", "primitive", "threads", "critical", "noncritical",
+          "writes", "ops/s", "fairness", "syscalls/op", "switches/op"
+        );
+        break;
+    case FORMAT_CSV:
+        fprintf(file, "primitive,threads,critical,noncritical,writes,ops,seconds,ops_per_second,fairness,syscalls_per_op,"
+                      "switches_per_op,valid\n");
+        break;
+    case FORMAT_JSON:
+        fprintf(file, "[\n");
+        break;
+    }
+}
+
+static void print_number(FILE *file, const char *format, double value, const char *missing)
+{
+    if (isnan(value))
+        fprintf(file, "%s", missing);
+    else
+        fprintf(file, format, value);
+}
+
+static void print_result(FILE *file, enum output_format format, const run_context *ctx, run_result r, int first)
+{
+    switch (format) {
+    case FORMAT_TABLE:
+        fprintf(
+          file, "%-24s %7u %8u %11u %6u %14.0f %8.3f ", ctx->primitive->name, ctx->threads, ctx->critical,
+          ctx->noncritical, ctx->writes, r.throughput, r.fairness
+        );
+        print_number(file, "%12.4f", r.syscalls_per_op, "           -");
+        print_number(file, " %12.4f", r.switches_per_op, "            -");
+        fprintf(file, "%s\n", r.valid ? "" : " INVALID");
+        break;
+    case FORMAT_CSV:
+        fprintf(
+          file, "%s,%u,%u,%u,%u,%" PRIu64 ",%.6f,%.1f,%.6f,", ctx->primitive->name, ctx->threads, ctx->critical,
+          ctx->noncritical, ctx->writes, r.ops, r.seconds, r.throughput, r.fairness
+        );
+        print_number(file, "%.6f", r.syscalls_per_op, "");
+        print_number(file, ",%.6f", r.switches_per_op, ",");
+        fprintf(file, ",%d\n", r.valid);
+        break;
+    case FORMAT_JSON:
+        fprintf(
+          file,
+          "%s  {\"primitive\": \"%s\", \"threads\": %u, \"critical\": %u, \"noncritical\": %u, \"writes\": %u, "
+          "\"ops\": %" PRIu64 ", \"seconds\": %.6f, \"ops_per_second\": %.1f, \"fairness\": %.6f, "
+          "\"syscalls_per_op\": ",
+          first ? "" : ",\n", ctx->primitive->name, ctx->threads, ctx->critical, ctx->noncritical, ctx->writes, r.ops,
+          r.seconds, r.throughput, r.fairness
+        );
+        print_number(file, "%.6f", r.syscalls_per_op, "null");
+        fprintf(file, ", \"switches_per_op\": ");
+        print_number(file, "%.6f", r.switches_per_op, "null");
+        fprintf(file, ", \"valid\": %s}", r.valid ? "true" : "false");
+        break;
+    }
+    fflush(file);
+}
+
+static void print_footer(FILE *file, enum output_format format)
+{
+    if (format == FORMAT_JSON)
+        fprintf(file, "\n]\n");
+}
+
+/*
+ * Command line
+ */
+static uint32_t parse_list(const char *text, uint32_t *values, const char *option)
+{
+    uint32_t count = 0;
+    char *end;
+
+    while (*text) {
+        if (count == MAX_VALUES) {
+            fprintf(stderr, "--%s: at most %d values\n", option, MAX_VALUES);
+            exit(EXIT_FAILURE);
+        }
+        values[count++] = strtoul(text, &end, 10);
+        if (end == text || (*end && *end != ',')) {
+            fprintf(stderr, "--%s: expected a comma separated list of numbers\n", option);
+            exit(EXIT_FAILURE);
+        }
+        text = *end ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static int primitive_selected(const char *list, const char *name)
+{
+    size_t length = strlen(name);
+
+    if (!list)
+        return 1;
+
+    for (const char *p = list; (p = strstr(p, name)); p += length)
+        if ((p == list || p[-1] == ',') && (p[length] == ',' || !p[length]))
+            return 1;
+
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(
+      stderr,
+      "Usage: %s [options]\n"
+      "  -t, --threads LIST       thread counts (default 1,2,4,8)\n"
+      "  -c, --critical LIST      critical section loop iterations (default 0,100,1000)\n"
+      "  -n, --noncritical LIST   non-critical section loop iterations (default 0,100)\n"
+      "  -w, --writes LIST        percent of exclusive acquisitions for reader/writer locks (default 0,10,50)\n"
+      "  -d, --duration MS        duration of every run in milliseconds (default 100)\n"
+      "  -p, --primitives LIST    primitives to run (default all)\n"
+      "  -f, --format FORMAT      table, csv or json (default table)\n"
+      "  -o, --output FILE        write results to FILE instead of stdout\n"
+      "  -l, --list               list primitives\n",
+      program
+    );
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+      {"threads", required_argument, NULL, 't'},
+      {"critical", required_argument, NULL, 'c'},
+      {"noncritical", required_argument, NULL, 'n'},
+      {"writes", required_argument, NULL, 'w'},
+      {"duration", required_argument, NULL, 'd'},
+      {"primitives", required_argument, NULL, 'p'},
+      {"format", required_argument, NULL, 'f'},
+      {"output", required_argument, NULL, 'o'},
+      {"list", no_argument, NULL, 'l'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+    };
+    uint32_t threads[MAX_VALUES] = {1, 2, 4, 8}, critical[MAX_VALUES] = {0, 100, 1000}, noncritical[MAX_VALUES] = {0, 100};
+    uint32_t writes[MAX_VALUES] = {0, 10, 50}, exclusive_writes = 100;
+    uint32_t threads_count = 4, critical_count = 3, noncritical_count = 2, writes_count = 3, duration = 100;
+    const char *selected = NULL;
+    enum output_format format = FORMAT_TABLE;
+    FILE *file = stdout;
+    run_context *ctx;
+    int option, first = 1;
+
+    while ((option = getopt_long(argc, argv, "t:c:n:w:d:p:f:o:lh", options, NULL)) != -1) {
+        switch (option) {
+        case 't':
+            threads_count = parse_list(optarg, threads, "threads");
+            break;
+        case 'c':
+            critical_count = parse_list(optarg, critical, "critical");
+            break;
+        case 'n':
+            noncritical_count = parse_list(optarg, noncritical, "noncritical");
+            break;
+        case 'w':
+            writes_count = parse_list(optarg, writes, "writes");
+            break;
+        case 'd':
+            duration = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            selected = optarg;
+            break;
+        case 'f':
+            if (!strcmp(optarg, "table"))
+                format = FORMAT_TABLE;
+            else if (!strcmp(optarg, "csv"))
+                format = FORMAT_CSV;
+            else if (!strcmp(optarg, "json"))
+                format = FORMAT_JSON;
+            else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            if (!(file = fopen(optarg, "w"))) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            for (size_t i = 0; i < PRIMITIVES_COUNT; i++)
+                printf("%s\n", primitives[i].name);
+            return EXIT_SUCCESS;
+        default:
+            usage(argv[0]);
+            return option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    for (uint32_t i = 0; i < threads_count; i++) {
+        if (!threads[i] || threads[i] > MAX_THREADS) {
+            fprintf(stderr, "--threads: thread counts must be in 1..%d\n", MAX_THREADS);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ctx = aligned_alloc(64, (sizeof(run_context) + 63) & ~(size_t) 63);
+
+    print_header(file, format);
+
+    for (size_t p = 0; p < PRIMITIVES_COUNT; p++) {
+        if (!primitive_selected(selected, primitives[p].name))
+            continue;
+
+        for (uint32_t t = 0; t < threads_count; t++)
+            for (uint32_t c = 0; c < critical_count; c++)
+                for (uint32_t n = 0; n < noncritical_count; n++) {
+                    uint32_t *ratios = primitives[p].rw ? writes : &exclusive_writes;
+                    uint32_t ratios_count = primitives[p].rw ? writes_count : 1;
+
+                    for (uint32_t w = 0; w < ratios_count; w++) {
+                        ctx->primitive   = &primitives[p];
+                        ctx->threads     = threads[t];
+                        ctx->critical    = critical[c];
+                        ctx->noncritical = noncritical[n];
+                        ctx->writes      = ratios[w];
+                        ctx->duration_ms = duration;
+
+                        print_result(file, format, ctx, run(ctx), first);
+                        first = 0;
+                    }
+                }
+    }
+
+    print_footer(file, format);
+
+    free(ctx);
+    if (file != stdout)
+        fclose(file);
+
+    return 0;
+}
@@ -2,14 +2,17 @@
 #include <math.h>
 #include <omp.h>
 #include <pthread.h>
+#include <inttypes.h>
 #include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
 
+#define AFL_COUNT_SYSCALLS
 #include "afl.h"
 
 #define RUNS_COUNT 100000
@@ -18,8 +21,9 @@
 
 #define FIBONACCI_MAX_VALUE 16
 
-static afl_mutex_t am     = AFL_MUTEX_INIT;
-static pthread_mutex_t pm = PTHREAD_MUTEX_INITIALIZER;
+static afl_mutex_t am           = AFL_MUTEX_INIT;
+static afl_mutex_adaptive_t aam = AFL_MUTEX_ADAPTIVE_INIT;
+static pthread_mutex_t pm       = PTHREAD_MUTEX_INITIALIZER;
 
 static timing_t benchmark_pthread_mutex(size_t iters)
 {
@@ -35,7 +39,7 @@ static timing_t benchmark_pthread_mutex(size_t iters)
         TIMING_NOW(start);
         pthread_mutex_unlock(&pm);
         TIMING_NOW(stop);
-        TIMING_ADD_DIFF(duration, start, stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
     }
 
     fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
@@ -57,7 +61,29 @@ static timing_t benchmark_atomic_mutex(size_t iters)
         TIMING_NOW(start);
         afl_mutex_unlock(&am);
         TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_adaptive_mutex(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        afl_mutex_adaptive_lock(&aam);
+        TIMING_NOW(stop);
         TIMING_ADD_DIFF(duration, start, stop);
+        total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);
+        TIMING_NOW(start);
+        afl_mutex_adaptive_unlock(&aam);
+        TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
     }
 
     fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
@@ -65,15 +91,62 @@ static timing_t benchmark_atomic_mutex(size_t iters)
     return duration;
 }
 
+typedef struct
+{
+    uint64_t syscalls;
+    long voluntary;
+    long involuntary;
+} slow_path_info;
+
+static slow_path_info do_bench_slow_path(benchmark_info *benchmark)
+{
+    struct rusage before, after;
+    uint64_t syscalls = afl_syscalls_count();
+
+    getrusage(RUSAGE_SELF, &before);
+    do_bench(benchmark);
+    getrusage(RUSAGE_SELF, &after);
+
+    return (slow_path_info) {
+      .syscalls    = afl_syscalls_count() - syscalls,
+      .voluntary   = after.ru_nvcsw - before.ru_nvcsw,
+      .involuntary = after.ru_nivcsw - before.ru_nivcsw,
+    };
+}
+
+static void print_slow_path(const char *n1, slow_path_info s1, const char *n2, slow_path_info s2)
+{
+    printf("\t\t\t       %s \t\t      %s\n", n1, n2);
+    printf("\t---------------------------------------------------------------\n");
+    printf("\t      futex syscalls:\t %15" PRIu64 "\t %15" PRIu64 "\n", s1.syscalls, s2.syscalls);
+    printf("\t voluntary switches:\t %15ld\t %15ld\n", s1.voluntary, s2.voluntary);
+    printf("\t    forced switches:\t %15ld\t %15ld\n", s1.involuntary, s2.involuntary);
+    printf("\t---------------------------------------------------------------\n");
+    printf("\n\n");
+}
+
 int main(void)
 {
-    benchmark_info pthread_mutex = {.name = "pthread", .func = benchmark_pthread_mutex};
-    benchmark_info atomic_mutex  = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info pthread_mutex  = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info atomic_mutex   = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info adaptive_mutex = {.name = "adaptive", .func = benchmark_adaptive_mutex};
+
+#ifdef AFL_STATS
+    afl_stats_register(&am, atomic_mutex.name);
+    afl_stats_register(&aam, adaptive_mutex.name);
+#endif
 
     do_bench(&pthread_mutex);
-    do_bench(&atomic_mutex);
+    slow_path_info atomic_slow_path   = do_bench_slow_path(&atomic_mutex);
+    slow_path_info adaptive_slow_path = do_bench_slow_path(&adaptive_mutex);
 
     print_benchmark(atomic_mutex, pthread_mutex);
+    print_benchmark(adaptive_mutex, atomic_mutex);
+    print_slow_path(adaptive_mutex.name, adaptive_slow_path, atomic_mutex.name, atomic_slow_path);
+
+#ifdef AFL_STATS
+    afl_stats_dump(stdout);
+#endif
 
     return 0;
 }
@@ -9,43 +9,81 @@
 #define WINE_MUTEX_TYPE afl_mutex_t
 #define WINE_MUTEX_RECURSIVE_TYPE afl_mutex_recursive_t
 #define WINE_ONCE_TYPE afl_once_t
+#define WINE_RWLOCK_TYPE afl_rwlock_t
+#define WINE_COND_TYPE afl_cond_t
+#define WINE_SEM_TYPE afl_sem_t
 
 #define WINE_SPIN_INIT(__SPINLOCK__, __SHARED__) afl_spin_init(__SPINLOCK__, __SHARED__)
 #define WINE_SPIN_LOCK(__SPINLOCK__) afl_spin_lock(__SPINLOCK__)
+#define WINE_SPIN_TRYLOCK(__SPINLOCK__) afl_spin_trylock(__SPINLOCK__)
 #define WINE_SPIN_UNLOCK(__SPINLOCK__) afl_spin_unlock(__SPINLOCK__)
 #define WINE_SPIN_DESTROY(__SPINLOCK__) afl_spin_destroy(__SPINLOCK__)
 
 #define WINE_MUTEX_INIT AFL_MUTEX_INIT
 #define WINE_MUTEX_LOCK(__MUTEX__) afl_mutex_lock(__MUTEX__)
+#define WINE_MUTEX_TRYLOCK(__MUTEX__) afl_mutex_trylock(__MUTEX__)
+#define WINE_MUTEX_TIMEDLOCK(__MUTEX__, __ABSTIME__) afl_mutex_timedlock(__MUTEX__, __ABSTIME__)
 #define WINE_MUTEX_UNLOCK(__MUTEX__) afl_mutex_unlock(__MUTEX__)
 #define WINE_MUTEX_DESTROY(__MUTEX__) afl_mutex_destroy(__MUTEX__)
 
 #define WINE_MUTEX_RECURSIVE_INIT(__MUTEX__) afl_mutex_recursive_init(__MUTEX__)
 #define WINE_MUTEX_RECURSIVE_LOCK(__MUTEX__) afl_mutex_recursive_lock(__MUTEX__)
+#define WINE_MUTEX_RECURSIVE_TRYLOCK(__MUTEX__) afl_mutex_recursive_trylock(__MUTEX__)
+#define WINE_MUTEX_RECURSIVE_TIMEDLOCK(__MUTEX__, __ABSTIME__) afl_mutex_recursive_timedlock(__MUTEX__, __ABSTIME__)
 #define WINE_MUTEX_RECURSIVE_UNLOCK(__MUTEX__) afl_mutex_recursive_unlock(__MUTEX__)
 #define WINE_MUTEX_RECURSIVE_DESTROY(__MUTEX__) afl_mutex_recursive_destroy(__MUTEX__)
 
 #define WINE_ONCE_INIT AFL_ONCE_INIT;
 #define WINE_ONCE(__ONCE__, __FUNCTION__) afl_once(__ONCE__, __FUNCTION__)
 
+#define WINE_RWLOCK_INIT AFL_RWLOCK_INIT
+#define WINE_RWLOCK_SHARED_LOCK(__RWLOCK__) afl_rwlock_shared_lock(__RWLOCK__)
+#define WINE_RWLOCK_SHARED_TRYLOCK(__RWLOCK__) afl_rwlock_shared_trylock(__RWLOCK__)
+#define WINE_RWLOCK_SHARED_UNLOCK(__RWLOCK__) afl_rwlock_shared_unlock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_LOCK(__RWLOCK__) afl_rwlock_exclusive_lock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_TRYLOCK(__RWLOCK__) afl_rwlock_exclusive_trylock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_UNLOCK(__RWLOCK__) afl_rwlock_exclusive_unlock(__RWLOCK__)
+#define WINE_RWLOCK_DESTROY(__RWLOCK__) afl_rwlock_destroy(__RWLOCK__)
+
+#define WINE_COND_INIT AFL_COND_INIT
+#define WINE_COND_WAIT(__COND__, __MUTEX__) afl_cond_wait(__COND__, __MUTEX__)
+#define WINE_COND_TIMEDWAIT(__COND__, __MUTEX__, __ABSTIME__) afl_cond_timedwait(__COND__, __MUTEX__, __ABSTIME__)
+#define WINE_COND_SIGNAL(__COND__) afl_cond_signal(__COND__)
+#define WINE_COND_BROADCAST(__COND__) afl_cond_broadcast(__COND__)
+#define WINE_COND_DESTROY(__COND__) afl_cond_destroy(__COND__)
+
+#define WINE_SEM_INIT(__SEM__, __VALUE__) afl_sem_init(__SEM__, __VALUE__)
+#define WINE_SEM_WAIT(__SEM__) afl_sem_wait(__SEM__)
+#define WINE_SEM_TRYWAIT(__SEM__) afl_sem_trywait(__SEM__)
+#define WINE_SEM_TIMEDWAIT(__SEM__, __ABSTIME__) afl_sem_timedwait(__SEM__, __ABSTIME__)
+#define WINE_SEM_POST(__SEM__) afl_sem_post(__SEM__)
+#define WINE_SEM_DESTROY(__SEM__) afl_sem_destroy(__SEM__)
+
 #else
 
 #error USE_AFL is not defined!
 
 #include "pthread.h"
+#include "semaphore.h"
 
 #define WINE_SPINLOCK_TYPE pthread_spinlock_t
 #define WINE_MUTEX_TYPE pthread_mutex_t
 #define WINE_MUTEX_RECURSIVE_TYPE pthread_mutex_t
 #define WINE_ONCE_TYPE pthread_once_t
+#define WINE_RWLOCK_TYPE pthread_rwlock_t
+#define WINE_COND_TYPE pthread_cond_t
+#define WINE_SEM_TYPE sem_t
 
 #define WINE_SPIN_INIT(__SPINLOCK__, __SHARED__) pthread_spin_init(__SPINLOCK__, __SHARED__)
 #define WINE_SPIN_LOCK(__SPINLOCK__) pthread_spin_lock(__SPINLOCK__)
+#define WINE_SPIN_TRYLOCK(__SPINLOCK__) pthread_spin_trylock(__SPINLOCK__)
 #define WINE_SPIN_UNLOCK(__SPINLOCK__) pthread_spin_unlock(__SPINLOCK__)
 #define WINE_SPIN_DESTROY(__SPINLOCK__) pthread_spin_destroy(__SPINLOCK__)
 
 #define WINE_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
 #define WINE_MUTEX_LOCK(__MUTEX__) pthread_mutex_owner_lock(__MUTEX__)
+#define WINE_MUTEX_TRYLOCK(__MUTEX__) pthread_mutex_trylock(__MUTEX__)
+#define WINE_MUTEX_TIMEDLOCK(__MUTEX__, __ABSTIME__) pthread_mutex_clocklock(__MUTEX__, CLOCK_MONOTONIC, __ABSTIME__)
 #define WINE_MUTEX_UNLOCK(__MUTEX__) pthread_mutex_owner_unlock(__MUTEX__)
 #define WINE_MUTEX_DESTROY(__MUTEX__) pthread_mutex_destroy(__MUTEX__)
 
@@ -58,12 +96,39 @@
         pthread_mutexattr_destroy(&attr);                          \
     } while (0)
 #define WINE_MUTEX_RECURSIVE_LOCK(__MUTEX__) pthread_mutex_lock(__MUTEX__)
+#define WINE_MUTEX_RECURSIVE_TRYLOCK(__MUTEX__) pthread_mutex_trylock(__MUTEX__)
+#define WINE_MUTEX_RECURSIVE_TIMEDLOCK(__MUTEX__, __ABSTIME__) \
+    pthread_mutex_clocklock(__MUTEX__, CLOCK_MONOTONIC, __ABSTIME__)
 #define WINE_MUTEX_RECURSIVE_UNLOCK(__MUTEX__) pthread_mutex_unlock(__MUTEX__)
 #define WINE_MUTEX_RECURSIVE_DESTROY(__MUTEX__) pthread_mutex_destroy(__MUTEX__)
 
 #define WINE_ONCE_INIT PTHREAD_ONCE_INIT;
 #define WINE_ONCE(__ONCE__, __FUNCTION__) pthread_once(__ONCE__, __FUNCTION__)
 
+#define WINE_RWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+#define WINE_RWLOCK_SHARED_LOCK(__RWLOCK__) pthread_rwlock_rdlock(__RWLOCK__)
+#define WINE_RWLOCK_SHARED_TRYLOCK(__RWLOCK__) pthread_rwlock_tryrdlock(__RWLOCK__)
+#define WINE_RWLOCK_SHARED_UNLOCK(__RWLOCK__) pthread_rwlock_unlock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_LOCK(__RWLOCK__) pthread_rwlock_wrlock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_TRYLOCK(__RWLOCK__) pthread_rwlock_trywrlock(__RWLOCK__)
+#define WINE_RWLOCK_EXCLUSIVE_UNLOCK(__RWLOCK__) pthread_rwlock_unlock(__RWLOCK__)
+#define WINE_RWLOCK_DESTROY(__RWLOCK__) pthread_rwlock_destroy(__RWLOCK__)
+
+#define WINE_COND_INIT PTHREAD_COND_INITIALIZER
+#define WINE_COND_WAIT(__COND__, __MUTEX__) pthread_cond_wait(__COND__, __MUTEX__)
+#define WINE_COND_TIMEDWAIT(__COND__, __MUTEX__, __ABSTIME__) \
+    pthread_cond_clockwait(__COND__, __MUTEX__, CLOCK_MONOTONIC, __ABSTIME__)
+#define WINE_COND_SIGNAL(__COND__) pthread_cond_signal(__COND__)
+#define WINE_COND_BROADCAST(__COND__) pthread_cond_broadcast(__COND__)
+#define WINE_COND_DESTROY(__COND__) pthread_cond_destroy(__COND__)
+
+#define WINE_SEM_INIT(__SEM__, __VALUE__) sem_init(__SEM__, 0, __VALUE__)
+#define WINE_SEM_WAIT(__SEM__) sem_wait(__SEM__)
+#define WINE_SEM_TRYWAIT(__SEM__) sem_trywait(__SEM__)
+#define WINE_SEM_TIMEDWAIT(__SEM__, __ABSTIME__) sem_clockwait(__SEM__, CLOCK_MONOTONIC, __ABSTIME__)
+#define WINE_SEM_POST(__SEM__) sem_post(__SEM__)
+#define WINE_SEM_DESTROY(__SEM__) sem_destroy(__SEM__)
+
 #endif
 
 #endif /* __WINE_WINE_MUTEX_H */
@@ -35,7 +35,7 @@ static timing_t benchmark_pthread_mutex(size_t iters)
         TIMING_NOW(start);
         pthread_mutex_unlock(&pm);
         TIMING_NOW(stop);
-        TIMING_ADD_DIFF(duration, start, stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
     }
 
     fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
@@ -57,7 +57,7 @@ static timing_t benchmark_atomic_mutex(size_t iters)
         TIMING_NOW(start);
         afl_mutex_owner_unlock(&am);
         TIMING_NOW(stop);
-        TIMING_ADD_DIFF(duration, start, stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
     }
 
     fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
@@ -0,0 +1,336 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 8
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define HOLD_US 100  // Low priority thread work with the lock held
+#define HOG_US 2000  // Medium priority thread work without the lock
+#define LOW_PRIORITY 10
+#define MEDIUM_PRIORITY 20
+#define HIGH_PRIORITY 30
+
+/*
+ * Priority inversion: all threads run SCHED_FIFO on one CPU. The low priority thread takes the lock,
+ * the high priority thread blocks on it and a medium priority thread becomes runnable and spins for HOG_US.
+ * Without priority inheritance the medium thread preempts the lock owner and the high priority wait includes HOG_US,
+ * with it the owner runs at the priority of the waiter and the wait is bounded by HOLD_US.
+ * The acquire latency rows are the wait of the high priority thread, the benchmark thread itself.
+ *
+ * For condition variables the high priority thread waits on the condition, the low priority thread locks the mutex,
+ * signals and holds the mutex for HOLD_US, the round measures from the signal until the waiter returns.
+ */
+typedef struct
+{
+    pthread_mutex_t pm;
+    pthread_mutex_t ppm;
+    afl_mutex_t am;
+    afl_mutex_t apm;
+    afl_mutex_recursive_t arm;
+    afl_mutex_recursive_t arpm;
+    afl_cond_t ac;
+    afl_cond_t apc;
+    afl_sem_t started;
+    afl_sem_t low_go;
+    afl_sem_t low_locked;
+    afl_sem_t medium_go;
+    afl_sem_t medium_done;
+    timing_t start;
+    int signaled;
+    int stop;
+} inversion_context;
+
+static int cpu;
+
+static int first_cpu(void)
+{
+    affinity_mask_t mask;
+
+    if (affinity_get(&mask))
+        return 0;
+
+    for (int i = 0; i < AFFINITY_MAX_CPUS; i++)
+        if (mask.bits[i / (8 * sizeof(unsigned long))] & (1UL << (i % (8 * sizeof(unsigned long)))))
+            return i;
+
+    return 0;
+}
+
+static int set_priority(int priority)
+{
+    struct sched_param param = {.sched_priority = priority};
+
+    affinity_pin(cpu);
+
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+static void busy_wait_us(long us)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000 < us);
+}
+
+static void inversion_init(inversion_context *c)
+{
+    pthread_mutexattr_t attr;
+
+    memset(c, 0, sizeof(*c));
+
+    pthread_mutex_init(&c->pm, NULL);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&c->ppm, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    c->am  = AFL_MUTEX_INIT;
+    c->apm = AFL_MUTEX_INIT;
+    afl_mutex_recursive_init(&c->arm);
+    afl_mutex_recursive_init(&c->arpm);
+    afl_cond_init(&c->ac);
+    afl_cond_init(&c->apc);
+    afl_sem_init(&c->started, 0);
+    afl_sem_init(&c->low_go, 0);
+    afl_sem_init(&c->low_locked, 0);
+    afl_sem_init(&c->medium_go, 0);
+    afl_sem_init(&c->medium_done, 0);
+}
+
+static void inversion_destroy(inversion_context *c)
+{
+    pthread_mutex_destroy(&c->pm);
+    pthread_mutex_destroy(&c->ppm);
+    afl_mutex_destroy(&c->am);
+    afl_mutex_destroy(&c->apm);
+    afl_mutex_recursive_destroy(&c->arm);
+    afl_mutex_recursive_destroy(&c->arpm);
+    afl_cond_destroy(&c->ac);
+    afl_cond_destroy(&c->apc);
+}
+
+static void *medium_thread(void *arg)
+{
+    inversion_context *c = arg;
+
+    set_priority(MEDIUM_PRIORITY);
+    afl_sem_post(&c->started);
+
+    for (;;) {
+        afl_sem_wait(&c->medium_go);
+        if (c->stop)
+            break;
+        busy_wait_us(HOG_US);
+        afl_sem_post(&c->medium_done);
+    }
+
+    return NULL;
+}
+
+static void inversion_start(inversion_context *c, pthread_t *low, void *(*low_thread)(void *), pthread_t *medium)
+{
+    inversion_init(c);
+    pthread_create(low, NULL, low_thread, c);
+    pthread_create(medium, NULL, medium_thread, c);
+    afl_sem_wait(&c->started);
+    afl_sem_wait(&c->started);
+}
+
+static void inversion_stop(inversion_context *c, pthread_t low, pthread_t medium)
+{
+    c->stop = 1;
+    afl_sem_post(&c->low_go);
+    afl_sem_post(&c->medium_go);
+    pthread_join(low, NULL);
+    pthread_join(medium, NULL);
+    inversion_destroy(c);
+}
+
+#define BENCHMARK_INVERSION(name, lock, unlock)                       \
+    static void *name##_low(void *arg)                                \
+    {                                                                 \
+        inversion_context *c = arg;                                   \
+                                                                      \
+        set_priority(LOW_PRIORITY);                                   \
+        afl_sem_post(&c->started);                                    \
+                                                                      \
+        for (;;) {                                                    \
+            afl_sem_wait(&c->low_go);                                 \
+            if (c->stop)                                              \
+                break;                                                \
+            lock;                                                     \
+            afl_sem_post(&c->low_locked);                             \
+            busy_wait_us(HOLD_US);                                    \
+            unlock;                                                   \
+        }                                                             \
+                                                                      \
+        return NULL;                                                  \
+    }                                                                 \
+                                                                      \
+    static timing_t benchmark_##name(size_t iters)                    \
+    {                                                                 \
+        timing_t start, stop, duration = 0;                           \
+        pthread_t low, medium;                                        \
+        inversion_context ctx, *c = &ctx;                             \
+                                                                      \
+        inversion_start(c, &low, name##_low, &medium);                \
+                                                                      \
+        for (size_t i = 0; i < iters; i++) {                          \
+            afl_sem_post(&c->low_go);                                 \
+            afl_sem_wait(&c->low_locked);                             \
+            afl_sem_post(&c->medium_go);                              \
+            TIMING_NOW(start);                                        \
+            lock;                                                     \
+            TIMING_NOW(stop);                                         \
+            TIMING_ADD_DIFF(duration, start, stop);                   \
+            unlock;                                                   \
+            afl_sem_wait(&c->medium_done);                            \
+        }                                                             \
+                                                                      \
+        inversion_stop(c, low, medium);                               \
+                                                                      \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);       \
+                                                                      \
+        return duration;                                              \
+    }
+
+BENCHMARK_INVERSION(pthread_mutex, pthread_mutex_lock(&c->pm), pthread_mutex_unlock(&c->pm))
+BENCHMARK_INVERSION(pthread_pi_mutex, pthread_mutex_lock(&c->ppm), pthread_mutex_unlock(&c->ppm))
+BENCHMARK_INVERSION(atomic_mutex, afl_mutex_lock(&c->am), afl_mutex_unlock(&c->am))
+BENCHMARK_INVERSION(atomic_pi_mutex, afl_mutex_pi_lock(&c->apm), afl_mutex_pi_unlock(&c->apm))
+BENCHMARK_INVERSION(atomic_recursive_mutex, ({
+                        afl_mutex_recursive_lock(&c->arm);
+                        afl_mutex_recursive_lock(&c->arm);
+                    }),
+                    ({
+                        afl_mutex_recursive_unlock(&c->arm);
+                        afl_mutex_recursive_unlock(&c->arm);
+                    }))
+BENCHMARK_INVERSION(atomic_recursive_pi_mutex, ({
+                        afl_mutex_recursive_pi_lock(&c->arpm);
+                        afl_mutex_recursive_pi_lock(&c->arpm);
+                    }),
+                    ({
+                        afl_mutex_recursive_pi_unlock(&c->arpm);
+                        afl_mutex_recursive_pi_unlock(&c->arpm);
+                    }))
+
+#define BENCHMARK_INVERSION_COND(name, lock, unlock, wait, signal)    \
+    static void *name##_low(void *arg)                                \
+    {                                                                 \
+        inversion_context *c = arg;                                   \
+                                                                      \
+        set_priority(LOW_PRIORITY);                                   \
+        afl_sem_post(&c->started);                                    \
+                                                                      \
+        for (;;) {                                                    \
+            afl_sem_wait(&c->low_go);                                 \
+            if (c->stop)                                              \
+                break;                                                \
+            lock;                                                     \
+            c->signaled = 1;                                          \
+            TIMING_NOW(c->start);                                     \
+            signal;                                                   \
+            afl_sem_post(&c->medium_go);                              \
+            busy_wait_us(HOLD_US);                                    \
+            unlock;                                                   \
+        }                                                             \
+                                                                      \
+        return NULL;                                                  \
+    }                                                                 \
+                                                                      \
+    static timing_t benchmark_##name(size_t iters)                    \
+    {                                                                 \
+        timing_t stop, duration = 0;                                  \
+        pthread_t low, medium;                                        \
+        inversion_context ctx, *c = &ctx;                             \
+                                                                      \
+        inversion_start(c, &low, name##_low, &medium);                \
+                                                                      \
+        for (size_t i = 0; i < iters; i++) {                          \
+            lock;                                                     \
+            afl_sem_post(&c->low_go);                                 \
+            while (!c->signaled)                                      \
+                wait;                                                 \
+            TIMING_NOW(stop);                                         \
+            TIMING_ADD_DIFF(duration, c->start, stop);                \
+            c->signaled = 0;                                          \
+            unlock;                                                   \
+            afl_sem_wait(&c->medium_done);                            \
+        }                                                             \
+                                                                      \
+        inversion_stop(c, low, medium);                               \
+                                                                      \
+        fprintf(stderr, "Duration: %.2f\n", (double) duration);       \
+                                                                      \
+        return duration;                                              \
+    }
+
+BENCHMARK_INVERSION_COND(
+  atomic_cond, afl_mutex_lock(&c->am), afl_mutex_unlock(&c->am), afl_cond_wait(&c->ac, &c->am),
+  afl_cond_signal(&c->ac)
+)
+BENCHMARK_INVERSION_COND(
+  atomic_pi_cond, afl_mutex_pi_lock(&c->apm), afl_mutex_pi_unlock(&c->apm), afl_cond_pi_wait(&c->apc, &c->apm),
+  afl_cond_pi_signal(&c->apc)
+)
+
+int main(void)
+{
+    int ret;
+
+    benchmark_info pthread_mutex             = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info pthread_pi_mutex          = {.name = "pthread_pi", .func = benchmark_pthread_pi_mutex};
+    benchmark_info atomic_mutex              = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info atomic_pi_mutex           = {.name = "atomic_pi", .func = benchmark_atomic_pi_mutex};
+    benchmark_info atomic_recursive_mutex    = {.name = "atomic_recursive", .func = benchmark_atomic_recursive_mutex};
+    benchmark_info atomic_recursive_pi_mutex = {
+      .name = "atomic_recursive_pi", .func = benchmark_atomic_recursive_pi_mutex
+    };
+    benchmark_info atomic_cond    = {.name = "atomic_cond", .func = benchmark_atomic_cond};
+    benchmark_info atomic_pi_cond = {.name = "atomic_pi_cond", .func = benchmark_atomic_pi_cond};
+
+    /* The benchmark thread is the high priority thread, do_bench must not run it in parallel. */
+    omp_set_num_threads(1);
+    cpu = first_cpu();
+
+    ret = set_priority(HIGH_PRIORITY);
+    if (ret) {
+        printf("\n\n\t SCHED_FIFO is not permitted (%s), run as root or with CAP_SYS_NICE\n\n\n", strerror(ret));
+        return 0;
+    }
+
+    do_bench(&pthread_mutex);
+    do_bench(&pthread_pi_mutex);
+    do_bench(&atomic_mutex);
+    do_bench(&atomic_pi_mutex);
+    do_bench(&atomic_recursive_mutex);
+    do_bench(&atomic_recursive_pi_mutex);
+    do_bench(&atomic_cond);
+    do_bench(&atomic_pi_cond);
+
+    print_benchmark(pthread_pi_mutex, pthread_mutex);
+    print_benchmark(atomic_pi_mutex, atomic_mutex);
+    print_benchmark(atomic_pi_mutex, pthread_pi_mutex);
+    print_benchmark(atomic_recursive_pi_mutex, atomic_recursive_mutex);
+    print_benchmark(atomic_pi_cond, atomic_cond);
+
+    printf("\t hold: %d us, medium priority spin: %d us, CPU: %d\n", HOLD_US, HOG_US, cpu);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 1000
+#define RUN_ITERATIONS 64
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 16
+
+/*
+ * Every run forks a child that hammers the same lock in a MAP_SHARED mapping while the parent is measured.
+ * The counters are only incremented under their lock, so they show whether mutual exclusion held across processes.
+ */
+enum
+{
+    PTHREAD_MUTEX,
+    PTHREAD_PI_MUTEX,
+    ATOMIC_MUTEX,
+    ATOMIC_OWNER_MUTEX,
+    ATOMIC_PI_MUTEX,
+    MUTEX_COUNT
+};
+
+typedef struct
+{
+    pthread_mutex_t pm;
+    pthread_mutex_t ppm;
+    afl_mutex_t am;
+    afl_mutex_t aom;
+    afl_mutex_t apm;
+    afl_once_t once;
+    size_t once_calls;
+    size_t counters[MUTEX_COUNT];
+} shared_memory;
+
+static shared_memory *shm;
+
+#define BENCHMARK_PSHARED_MUTEX(name, counter, lock, unlock)                           \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        pid_t pid        = fork();                                                     \
+                                                                                       \
+        if (pid == 0) {                                                                \
+            for (size_t i = 0; i < iters; i++) {                                       \
+                lock;                                                                  \
+                shm->counters[counter]++;                                              \
+                total_sum += fibonacci(FIBONACCI_MAX_VALUE - i % 8);                   \
+                unlock;                                                                \
+            }                                                                          \
+            _exit(0);                                                                  \
+        }                                                                              \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            lock;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            shm->counters[counter]++;                                                  \
+            total_sum += fibonacci(FIBONACCI_MAX_VALUE - i % 8);                       \
+            TIMING_NOW(start);                                                         \
+            unlock;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        waitpid(pid, NULL, 0);                                                         \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_PSHARED_MUTEX(pthread_mutex, PTHREAD_MUTEX, pthread_mutex_lock(&shm->pm), pthread_mutex_unlock(&shm->pm))
+BENCHMARK_PSHARED_MUTEX(
+  pthread_pi_mutex, PTHREAD_PI_MUTEX, pthread_mutex_lock(&shm->ppm), pthread_mutex_unlock(&shm->ppm)
+)
+BENCHMARK_PSHARED_MUTEX(
+  atomic_mutex, ATOMIC_MUTEX, afl_mutex_pshared_lock(&shm->am), afl_mutex_pshared_unlock(&shm->am)
+)
+BENCHMARK_PSHARED_MUTEX(
+  atomic_owner_mutex, ATOMIC_OWNER_MUTEX, afl_mutex_pshared_owner_lock(&shm->aom),
+  afl_mutex_pshared_owner_unlock(&shm->aom)
+)
+BENCHMARK_PSHARED_MUTEX(
+  atomic_pi_mutex, ATOMIC_PI_MUTEX, afl_mutex_pshared_pi_lock(&shm->apm), afl_mutex_pshared_pi_unlock(&shm->apm)
+)
+
+static void init_function(void)
+{
+    __atomic_add_fetch(&shm->once_calls, 1, __ATOMIC_RELAXED);
+}
+
+static void check_once(void)
+{
+    pid_t pids[8];
+
+    for (size_t i = 0; i < 8; i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            afl_once_pshared(&shm->once, init_function);
+            _exit(0);
+        }
+    }
+
+    afl_once_pshared(&shm->once, init_function);
+
+    for (size_t i = 0; i < 8; i++)
+        waitpid(pids[i], NULL, 0);
+
+    printf("\n\n\t once init calls: %zu\n", shm->once_calls);
+}
+
+int main(void)
+{
+    pthread_mutexattr_t attr;
+    size_t expected = (size_t) BENCHMARK_RUNS * RUN_ITERATIONS * 2;
+
+    shm = mmap(NULL, sizeof(shared_memory), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&shm->pm, &attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&shm->ppm, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    shm->am   = AFL_MUTEX_INIT;
+    shm->aom  = AFL_MUTEX_INIT;
+    shm->apm  = AFL_MUTEX_INIT;
+    shm->once = AFL_ONCE_INIT;
+
+    benchmark_info pthread_mutex      = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info pthread_pi_mutex   = {.name = "pthread_pi", .func = benchmark_pthread_pi_mutex};
+    benchmark_info atomic_mutex       = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info atomic_owner_mutex = {.name = "atomic_owner", .func = benchmark_atomic_owner_mutex};
+    benchmark_info atomic_pi_mutex    = {.name = "atomic_pi", .func = benchmark_atomic_pi_mutex};
+
+    do_bench(&pthread_mutex);
+    do_bench(&pthread_pi_mutex);
+    do_bench(&atomic_mutex);
+    do_bench(&atomic_owner_mutex);
+    do_bench(&atomic_pi_mutex);
+
+    print_benchmark(atomic_mutex, pthread_mutex);
+    print_benchmark(atomic_owner_mutex, pthread_mutex);
+    print_benchmark(atomic_pi_mutex, pthread_pi_mutex);
+
+    printf("\t counters (expected %zu):", expected);
+    for (size_t i = 0; i < MUTEX_COUNT; i++)
+        printf(" %zu", shm->counters[i]);
+    printf("\n");
+
+    check_once();
+
+    munmap(shm, sizeof(shared_memory));
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 100000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 16
+
+static afl_mutex_robust_t am = AFL_MUTEX_ROBUST_INIT;
+static afl_mutex_t aom       = AFL_MUTEX_INIT;
+static pthread_mutex_t pm;
+
+static timing_t benchmark_pthread_mutex(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        pthread_mutex_lock(&pm);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+        total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);
+        TIMING_NOW(start);
+        pthread_mutex_unlock(&pm);
+        TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_mutex(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        afl_mutex_robust_lock(&am);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+        total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);
+        TIMING_NOW(start);
+        afl_mutex_robust_unlock(&am);
+        TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_owner_mutex(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        afl_mutex_pshared_owner_lock(&aom);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+        total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);
+        TIMING_NOW(start);
+        afl_mutex_pshared_owner_unlock(&aom);
+        TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static const char *error_name(int error)
+{
+    switch (error) {
+    case 0:
+        return "0";
+    case EOWNERDEAD:
+        return "EOWNERDEAD";
+    case ENOTRECOVERABLE:
+        return "ENOTRECOVERABLE";
+    default:
+        return strerror(error);
+    }
+}
+
+static void *die_holding(void *arg)
+{
+    afl_mutex_robust_lock(arg);
+    return NULL;
+}
+
+/*
+ * The owner, a forked child or a thread, exits holding the mutex, the next lock must return EOWNERDEAD.
+ * With afl_mutex_robust_consistent the mutex is usable again, without it the unlock makes it ENOTRECOVERABLE.
+ */
+static void check_robust(afl_mutex_robust_t *mutex, int thread, int consistent)
+{
+    int dead, repaired = 0, unlocked, relocked, retried;
+
+    afl_mutex_robust_init(mutex);
+
+    if (thread) {
+        pthread_t owner;
+        pthread_create(&owner, NULL, die_holding, mutex);
+        pthread_join(owner, NULL);
+    } else {
+        pid_t pid = fork();
+        if (pid == 0) {
+            afl_mutex_robust_lock(mutex);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+
+    dead = afl_mutex_robust_lock(mutex);
+    if (consistent)
+        repaired = afl_mutex_robust_consistent(mutex);
+    unlocked = afl_mutex_robust_unlock(mutex);
+    relocked = afl_mutex_robust_lock(mutex);
+    if (!relocked)
+        afl_mutex_robust_unlock(mutex);
+    retried = afl_mutex_robust_trylock(mutex);
+    if (!retried)
+        afl_mutex_robust_unlock(mutex);
+
+    printf(
+      "\t %s owner died, %s: lock %s, consistent %s, unlock %s, lock %s, trylock %s\n", thread ? "thread" : "process",
+      consistent ? "consistent" : "not consistent", error_name(dead), consistent ? error_name(repaired) : "-",
+      error_name(unlocked), error_name(relocked), error_name(retried)
+    );
+}
+
+/*
+ * The pthread mutex is robust and process-shared, like every afl robust mutex.
+ * The pshared owner mutex shows the cost of the robust list bookkeeping.
+ */
+int main(void)
+{
+    pthread_mutexattr_t attr;
+    afl_mutex_robust_t *shared;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&pm, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    benchmark_info pthread_mutex      = {.name = "pthread", .func = benchmark_pthread_mutex};
+    benchmark_info atomic_mutex       = {.name = "atomic", .func = benchmark_atomic_mutex};
+    benchmark_info atomic_owner_mutex = {.name = "atomic_owner", .func = benchmark_atomic_owner_mutex};
+
+    do_bench(&pthread_mutex);
+    do_bench(&atomic_mutex);
+    do_bench(&atomic_owner_mutex);
+
+    print_benchmark(atomic_mutex, pthread_mutex);
+    print_benchmark(atomic_mutex, atomic_owner_mutex);
+
+    pthread_mutex_destroy(&pm);
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("\n\n");
+    check_robust(shared, 0, 1);
+    check_robust(shared, 0, 0);
+    check_robust(shared, 1, 1);
+    check_robust(shared, 1, 0);
+
+    munmap(shared, sizeof(*shared));
+
+    return 0;
+}
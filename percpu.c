@@ -0,0 +1,126 @@
+#include <linux/futex.h>
+#include <inttypes.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 100000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+/*
+ * Per-CPU statistics counters: the rseq per-CPU lock and the sharded afl_spinlock_t fallback
+ * against one global afl_spin_lock protecting a single counter.
+ */
+typedef struct
+{
+    uint64_t value;
+} __AFL_ALIGN counter_t;
+
+static afl_percpu_t rseq_lock, sharded_lock;
+static counter_t *rseq_counters, *sharded_counters;
+static afl_spinlock_t global_lock;
+static counter_t global_counter;
+
+static timing_t benchmark_global_spinlock(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        afl_spin_lock(&global_lock);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+        global_counter.value++;
+        TIMING_NOW(start);
+        afl_spin_unlock(&global_lock);
+        TIMING_NOW(stop);
+        TIMING_ADD_RELEASE(duration, start, stop);
+    }
+
+    return duration;
+}
+
+#define BENCHMARK_PERCPU(name, lock, counters)                         \
+    static timing_t benchmark_##name(size_t iters)                     \
+    {                                                                  \
+        timing_t start, stop, duration = 0;                            \
+        uint32_t shard;                                                \
+                                                                       \
+        for (size_t i = 0; i < iters; i++) {                           \
+            TIMING_NOW(start);                                         \
+            afl_percpu_lock(&lock, &shard);                            \
+            TIMING_NOW(stop);                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                    \
+            counters[shard].value++;                                   \
+            TIMING_NOW(start);                                         \
+            afl_percpu_unlock(&lock, shard);                           \
+            TIMING_NOW(stop);                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                 \
+        }                                                              \
+                                                                       \
+        return duration;                                               \
+    }
+
+BENCHMARK_PERCPU(rseq_percpu, rseq_lock, rseq_counters)
+BENCHMARK_PERCPU(sharded_percpu, sharded_lock, sharded_counters)
+
+static uint64_t counters_sum(const counter_t *counters, uint32_t count)
+{
+    uint64_t sum = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+        sum += counters[i].value;
+
+    return sum;
+}
+
+int main(void)
+{
+    size_t expected = (size_t) BENCHMARK_RUNS * RUN_ITERATIONS;
+
+    afl_spin_init(&global_lock, 0);
+    if (afl_percpu_init(&rseq_lock) || afl_percpu_sharded_init(&sharded_lock)) {
+        perror("afl_percpu_init");
+        return 1;
+    }
+
+    rseq_counters    = aligned_alloc(sizeof(counter_t), rseq_lock.count * sizeof(counter_t));
+    sharded_counters = aligned_alloc(sizeof(counter_t), sharded_lock.count * sizeof(counter_t));
+    memset(rseq_counters, 0, rseq_lock.count * sizeof(counter_t));
+    memset(sharded_counters, 0, sharded_lock.count * sizeof(counter_t));
+
+    benchmark_info global_spinlock = {.name = "global", .func = benchmark_global_spinlock};
+    benchmark_info rseq_percpu     = {.name = "rseq", .func = benchmark_rseq_percpu};
+    benchmark_info sharded_percpu  = {.name = "sharded", .func = benchmark_sharded_percpu};
+
+    if (!rseq_lock.rseq)
+        printf("\n\n\t rseq is not available, the rseq benchmark uses the sharded fallback\n");
+
+    do_bench(&global_spinlock);
+    do_bench(&rseq_percpu);
+    do_bench(&sharded_percpu);
+
+    print_benchmark(rseq_percpu, global_spinlock);
+    print_benchmark(sharded_percpu, global_spinlock);
+    print_benchmark(rseq_percpu, sharded_percpu);
+
+    printf("\t counters (expected %zu): %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", expected, global_counter.value,
+           counters_sum(rseq_counters, rseq_lock.count), counters_sum(sharded_counters, sharded_lock.count));
+
+    free(rseq_counters);
+    free(sharded_counters);
+    afl_percpu_destroy(&rseq_lock);
+    afl_percpu_destroy(&sharded_lock);
+
+    return 0;
+}
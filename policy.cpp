@@ -0,0 +1,218 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.hpp"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 16
+
+/*
+ * Every afl::basic_lock alias against the afl_* functions it replaces.
+ * The pairs should not differ significantly, the counters are incremented only under the lock.
+ */
+enum
+{
+    EXCHANGE_SPINLOCK,
+    TTAS_SPINLOCK,
+    OWNER_SPINLOCK,
+    FUTEX_MUTEX,
+    OWNER_MUTEX,
+    ADAPTIVE_MUTEX,
+    RECURSIVE_MUTEX,
+    PI_MUTEX,
+    RECURSIVE_PI_MUTEX,
+    LOCK_COUNT
+};
+
+static size_t c_counters[LOCK_COUNT], cpp_counters[LOCK_COUNT];
+
+static afl_spinlock_t exchange_spinlock;
+static afl_spinlock_t ttas_spinlock;
+static afl_spinlock_t owner_spinlock;
+static afl_mutex_t futex_mutex          = AFL_MUTEX_INIT;
+static afl_mutex_t owner_mutex          = AFL_MUTEX_INIT;
+static afl_mutex_adaptive_t adaptive    = AFL_MUTEX_ADAPTIVE_INIT;
+static afl_mutex_recursive_t recursive  = {0, 0};
+static afl_mutex_t pi_mutex             = AFL_MUTEX_INIT;
+static afl_mutex_recursive_t recursive_pi = {0, 0};
+
+static afl::exchange_spinlock cpp_exchange_spinlock;
+static afl::ttas_spinlock cpp_ttas_spinlock;
+static afl::owner_spinlock cpp_owner_spinlock;
+static afl::futex_mutex cpp_futex_mutex;
+static afl::owner_mutex cpp_owner_mutex;
+static afl::adaptive_mutex cpp_adaptive;
+static afl::recursive_futex_mutex cpp_recursive;
+static afl::pi_mutex cpp_pi_mutex;
+static afl::recursive_pi_mutex cpp_recursive_pi;
+
+#define BENCHMARK_LOCK(name, counters, counter, lock, unlock)                          \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            lock;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            counters[counter]++;                                                       \
+            total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);                           \
+            TIMING_NOW(start);                                                         \
+            unlock;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_LOCK(
+  c_exchange_spinlock, c_counters, EXCHANGE_SPINLOCK, afl_spin_exchange_lock(&exchange_spinlock),
+  afl_spin_exchange_unlock(&exchange_spinlock)
+)
+BENCHMARK_LOCK(
+  c_ttas_spinlock, c_counters, TTAS_SPINLOCK, afl_spin_ttas_lock(&ttas_spinlock), afl_spin_ttas_unlock(&ttas_spinlock)
+)
+BENCHMARK_LOCK(
+  c_owner_spinlock, c_counters, OWNER_SPINLOCK, afl_spin_owner_lock(&owner_spinlock),
+  afl_spin_owner_unlock(&owner_spinlock)
+)
+BENCHMARK_LOCK(c_futex_mutex, c_counters, FUTEX_MUTEX, afl_mutex_lock(&futex_mutex), afl_mutex_unlock(&futex_mutex))
+BENCHMARK_LOCK(
+  c_owner_mutex, c_counters, OWNER_MUTEX, afl_mutex_owner_lock(&owner_mutex), afl_mutex_owner_unlock(&owner_mutex)
+)
+BENCHMARK_LOCK(
+  c_adaptive_mutex, c_counters, ADAPTIVE_MUTEX, afl_mutex_adaptive_lock(&adaptive), afl_mutex_adaptive_unlock(&adaptive)
+)
+BENCHMARK_LOCK(c_recursive_mutex, c_counters, RECURSIVE_MUTEX, ({
+                   afl_mutex_recursive_lock(&recursive);
+                   afl_mutex_recursive_lock(&recursive);
+               }),
+               ({
+                   afl_mutex_recursive_unlock(&recursive);
+                   afl_mutex_recursive_unlock(&recursive);
+               }))
+BENCHMARK_LOCK(c_pi_mutex, c_counters, PI_MUTEX, afl_mutex_pi_lock(&pi_mutex), afl_mutex_pi_unlock(&pi_mutex))
+BENCHMARK_LOCK(c_recursive_pi_mutex, c_counters, RECURSIVE_PI_MUTEX, ({
+                   afl_mutex_recursive_pi_lock(&recursive_pi);
+                   afl_mutex_recursive_pi_lock(&recursive_pi);
+               }),
+               ({
+                   afl_mutex_recursive_pi_unlock(&recursive_pi);
+                   afl_mutex_recursive_pi_unlock(&recursive_pi);
+               }))
+
+BENCHMARK_LOCK(
+  cpp_exchange_spinlock, cpp_counters, EXCHANGE_SPINLOCK, cpp_exchange_spinlock.lock(), cpp_exchange_spinlock.unlock()
+)
+BENCHMARK_LOCK(cpp_ttas_spinlock, cpp_counters, TTAS_SPINLOCK, cpp_ttas_spinlock.lock(), cpp_ttas_spinlock.unlock())
+BENCHMARK_LOCK(cpp_owner_spinlock, cpp_counters, OWNER_SPINLOCK, cpp_owner_spinlock.lock(), cpp_owner_spinlock.unlock())
+BENCHMARK_LOCK(cpp_futex_mutex, cpp_counters, FUTEX_MUTEX, cpp_futex_mutex.lock(), cpp_futex_mutex.unlock())
+BENCHMARK_LOCK(cpp_owner_mutex, cpp_counters, OWNER_MUTEX, cpp_owner_mutex.lock(), cpp_owner_mutex.unlock())
+BENCHMARK_LOCK(cpp_adaptive_mutex, cpp_counters, ADAPTIVE_MUTEX, cpp_adaptive.lock(), cpp_adaptive.unlock())
+BENCHMARK_LOCK(cpp_recursive_mutex, cpp_counters, RECURSIVE_MUTEX, ({
+                   cpp_recursive.lock();
+                   cpp_recursive.lock();
+               }),
+               ({
+                   cpp_recursive.unlock();
+                   cpp_recursive.unlock();
+               }))
+BENCHMARK_LOCK(cpp_pi_mutex, cpp_counters, PI_MUTEX, cpp_pi_mutex.lock(), cpp_pi_mutex.unlock())
+BENCHMARK_LOCK(cpp_recursive_pi_mutex, cpp_counters, RECURSIVE_PI_MUTEX, ({
+                   cpp_recursive_pi.lock();
+                   cpp_recursive_pi.lock();
+               }),
+               ({
+                   cpp_recursive_pi.unlock();
+                   cpp_recursive_pi.unlock();
+               }))
+
+/*
+ * The guards nest a recursive lock inside a lock_guard and hand a unique_lock over, the count must be exact.
+ */
+static void check_guards(void)
+{
+    static afl::owner_mutex outer;
+    static afl::recursive_pi_mutex inner;
+    size_t count = 0;
+
+#pragma omp parallel for
+    for (size_t i = 0; i < 100000; i++) {
+        afl::lock_guard<afl::owner_mutex> guard(outer);
+        afl::unique_lock<afl::recursive_pi_mutex> first(inner);
+        afl::unique_lock<afl::recursive_pi_mutex> second(inner, afl::try_to_lock);
+        afl::unique_lock<afl::recursive_pi_mutex> moved(
+          static_cast<afl::unique_lock<afl::recursive_pi_mutex> &&>(second)
+        );
+        if (guard.error() == 0 && first && moved && !second)
+            count++;
+    }
+
+    printf("\t guards: %zu of 100000\n", count);
+}
+
+int main(void)
+{
+    static const char *names[LOCK_COUNT] = {"exchange_spinlock", "ttas_spinlock",    "owner_spinlock",
+                                            "futex_mutex",       "owner_mutex",      "adaptive_mutex",
+                                            "recursive_mutex",   "pi_mutex",         "recursive_pi_mutex"};
+    benchmark_info c[LOCK_COUNT]          = {
+      {.name = "afl_spin_exchange", .func = benchmark_c_exchange_spinlock},
+      {.name = "afl_spin_ttas", .func = benchmark_c_ttas_spinlock},
+      {.name = "afl_spin_owner", .func = benchmark_c_owner_spinlock},
+      {.name = "afl_mutex", .func = benchmark_c_futex_mutex},
+      {.name = "afl_mutex_owner", .func = benchmark_c_owner_mutex},
+      {.name = "afl_mutex_adaptive", .func = benchmark_c_adaptive_mutex},
+      {.name = "afl_mutex_recursive", .func = benchmark_c_recursive_mutex},
+      {.name = "afl_mutex_pi", .func = benchmark_c_pi_mutex},
+      {.name = "afl_mutex_recursive_pi", .func = benchmark_c_recursive_pi_mutex},
+    };
+    benchmark_info cpp[LOCK_COUNT] = {
+      {.name = "exchange_spinlock", .func = benchmark_cpp_exchange_spinlock},
+      {.name = "ttas_spinlock", .func = benchmark_cpp_ttas_spinlock},
+      {.name = "owner_spinlock", .func = benchmark_cpp_owner_spinlock},
+      {.name = "futex_mutex", .func = benchmark_cpp_futex_mutex},
+      {.name = "owner_mutex", .func = benchmark_cpp_owner_mutex},
+      {.name = "adaptive_mutex", .func = benchmark_cpp_adaptive_mutex},
+      {.name = "recursive_futex_mutex", .func = benchmark_cpp_recursive_mutex},
+      {.name = "pi_mutex", .func = benchmark_cpp_pi_mutex},
+      {.name = "recursive_pi_mutex", .func = benchmark_cpp_recursive_pi_mutex},
+    };
+    size_t expected = (size_t) BENCHMARK_RUNS * RUN_ITERATIONS;
+
+    afl_spin_init(&exchange_spinlock, 0);
+    afl_spin_init(&ttas_spinlock, 0);
+    afl_spin_init(&owner_spinlock, 0);
+
+    for (size_t i = 0; i < LOCK_COUNT; i++) {
+        do_bench(&c[i]);
+        do_bench(&cpp[i]);
+    }
+
+    for (size_t i = 0; i < LOCK_COUNT; i++)
+        print_benchmark(cpp[i], c[i]);
+
+    printf("\t counters (expected %zu):\n", expected);
+    for (size_t i = 0; i < LOCK_COUNT; i++)
+        printf("\t %22s: %zu %zu\n", names[i], c_counters[i], cpp_counters[i]);
+
+    check_guards();
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 100000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 16
+#define WRITER_PERIOD 8 // One exclusive acquisition per WRITER_PERIOD iterations, the rest are shared
+
+static afl_rwlock_t arw                = AFL_RWLOCK_INIT;
+static pthread_rwlock_t prw            = PTHREAD_RWLOCK_INITIALIZER;
+static volatile size_t protected_value = 0;
+
+static timing_t benchmark_pthread_rwlock(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        if (i % WRITER_PERIOD == WRITER_PERIOD - 1) {
+            TIMING_NOW(start);
+            pthread_rwlock_wrlock(&prw);
+            TIMING_NOW(stop);
+            TIMING_ADD_DIFF(duration, start, stop);
+            protected_value = fibonacci(FIBONACCI_MAX_VALUE - i);
+            TIMING_NOW(start);
+            pthread_rwlock_unlock(&prw);
+            TIMING_NOW(stop);
+            TIMING_ADD_RELEASE(duration, start, stop);
+        } else {
+            TIMING_NOW(start);
+            pthread_rwlock_rdlock(&prw);
+            TIMING_NOW(stop);
+            TIMING_ADD_DIFF(duration, start, stop);
+            total_sum += protected_value + fibonacci(FIBONACCI_MAX_VALUE - i);
+            TIMING_NOW(start);
+            pthread_rwlock_unlock(&prw);
+            TIMING_NOW(stop);
+            TIMING_ADD_RELEASE(duration, start, stop);
+        }
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_rwlock(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    size_t total_sum = 0;
+
+    for (size_t i = 0; i < iters; i++) {
+        if (i % WRITER_PERIOD == WRITER_PERIOD - 1) {
+            TIMING_NOW(start);
+            afl_rwlock_exclusive_lock(&arw);
+            TIMING_NOW(stop);
+            TIMING_ADD_DIFF(duration, start, stop);
+            protected_value = fibonacci(FIBONACCI_MAX_VALUE - i);
+            TIMING_NOW(start);
+            afl_rwlock_exclusive_unlock(&arw);
+            TIMING_NOW(stop);
+            TIMING_ADD_RELEASE(duration, start, stop);
+        } else {
+            TIMING_NOW(start);
+            afl_rwlock_shared_lock(&arw);
+            TIMING_NOW(stop);
+            TIMING_ADD_DIFF(duration, start, stop);
+            total_sum += protected_value + fibonacci(FIBONACCI_MAX_VALUE - i);
+            TIMING_NOW(start);
+            afl_rwlock_shared_unlock(&arw);
+            TIMING_NOW(stop);
+            TIMING_ADD_RELEASE(duration, start, stop);
+        }
+    }
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+int main(void)
+{
+    benchmark_info pthread_rwlock = {.name = "pthread", .func = benchmark_pthread_rwlock};
+    benchmark_info atomic_rwlock  = {.name = "atomic", .func = benchmark_atomic_rwlock};
+
+    do_bench(&pthread_rwlock);
+    do_bench(&atomic_rwlock);
+
+    print_benchmark(atomic_rwlock, pthread_rwlock);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 256
+#define RUN_ITERATIONS 4096
+#include "benchmark.h"
+
+#define QUEUE_SIZE 16
+
+/*
+ * Bounded queue between one producer thread and the consumer that runs the benchmark.
+ * empty counts free slots, full counts queued items, so both sides block when the queue is full or empty.
+ */
+typedef struct
+{
+    sem_t pempty, pfull;
+    afl_sem_t aempty, afull;
+    size_t items[QUEUE_SIZE];
+    size_t count;
+} queue_context;
+
+static void *pthread_producer(void *arg)
+{
+    queue_context *ctx = arg;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        sem_wait(&ctx->pempty);
+        ctx->items[i % QUEUE_SIZE] = i;
+        sem_post(&ctx->pfull);
+    }
+
+    return NULL;
+}
+
+static void *atomic_producer(void *arg)
+{
+    queue_context *ctx = arg;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        afl_sem_wait(&ctx->aempty);
+        ctx->items[i % QUEUE_SIZE] = i;
+        afl_sem_post(&ctx->afull);
+    }
+
+    return NULL;
+}
+
+static timing_t benchmark_pthread_sem(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    pthread_t thread;
+    queue_context ctx = {.count = iters};
+    size_t total_sum  = 0;
+
+    sem_init(&ctx.pempty, 0, QUEUE_SIZE);
+    sem_init(&ctx.pfull, 0, 0);
+
+    TIMING_NOW(start);
+    pthread_create(&thread, NULL, pthread_producer, &ctx);
+    for (size_t i = 0; i < iters; i++) {
+        sem_wait(&ctx.pfull);
+        total_sum += ctx.items[i % QUEUE_SIZE];
+        sem_post(&ctx.pempty);
+    }
+    pthread_join(thread, NULL);
+    TIMING_NOW(stop);
+    TIMING_ADD_DIFF(duration, start, stop);
+
+    sem_destroy(&ctx.pfull);
+    sem_destroy(&ctx.pempty);
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_sem(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    pthread_t thread;
+    queue_context ctx = {.count = iters};
+    size_t total_sum  = 0;
+
+    afl_sem_init(&ctx.aempty, QUEUE_SIZE);
+    afl_sem_init(&ctx.afull, 0);
+
+    TIMING_NOW(start);
+    pthread_create(&thread, NULL, atomic_producer, &ctx);
+    for (size_t i = 0; i < iters; i++) {
+        afl_sem_wait(&ctx.afull);
+        total_sum += ctx.items[i % QUEUE_SIZE];
+        afl_sem_post(&ctx.aempty);
+    }
+    pthread_join(thread, NULL);
+    TIMING_NOW(stop);
+    TIMING_ADD_DIFF(duration, start, stop);
+
+    afl_sem_destroy(&ctx.afull);
+    afl_sem_destroy(&ctx.aempty);
+
+    fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration);
+
+    return duration;
+}
+
+/*
+ * Post and wait on the same thread, the count never drops to zero, so no futex is called.
+ */
+static timing_t benchmark_pthread_sem_uncontended(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    sem_t sem;
+
+    sem_init(&sem, 0, 1);
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        sem_wait(&sem);
+        sem_post(&sem);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+    }
+
+    sem_destroy(&sem);
+
+    return duration;
+}
+
+static timing_t benchmark_atomic_sem_uncontended(size_t iters)
+{
+    timing_t start, stop, duration = 0;
+    afl_sem_t sem = AFL_SEM_INIT(1);
+
+    for (size_t i = 0; i < iters; i++) {
+        TIMING_NOW(start);
+        afl_sem_wait(&sem);
+        afl_sem_post(&sem);
+        TIMING_NOW(stop);
+        TIMING_ADD_DIFF(duration, start, stop);
+    }
+
+    afl_sem_destroy(&sem);
+
+    return duration;
+}
+
+int main(void)
+{
+    benchmark_info pthread_sem = {.name = "pthread", .func = benchmark_pthread_sem};
+    benchmark_info atomic_sem  = {.name = "atomic", .func = benchmark_atomic_sem};
+
+    benchmark_info pthread_uncontended = {.name = "pthread uncontended", .func = benchmark_pthread_sem_uncontended};
+    benchmark_info atomic_uncontended  = {.name = "atomic uncontended", .func = benchmark_atomic_sem_uncontended};
+
+    do_bench(&pthread_sem);
+    do_bench(&atomic_sem);
+    do_bench(&pthread_uncontended);
+    do_bench(&atomic_uncontended);
+
+    print_benchmark(atomic_sem, pthread_sem);
+    print_benchmark(atomic_uncontended, pthread_uncontended);
+
+    return 0;
+}
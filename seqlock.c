@@ -0,0 +1,160 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define WRITE_PERIOD_US 100
+
+/*
+ * Reader throughput while a writer thread updates every record once per WRITE_PERIOD_US.
+ * A record is a small snapshot whose last field is the sum of the others, readers count torn copies.
+ */
+typedef struct
+{
+    uint64_t a, b, c;
+    uint64_t sum;
+} record_t;
+
+static afl_seqlock_t seqlock    = AFL_SEQLOCK_INIT;
+static afl_mutex_t mutex        = AFL_MUTEX_INIT;
+static afl_rwlock_t rwlock      = AFL_RWLOCK_INIT;
+static pthread_rwlock_t prwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+static record_t seqlock_record, mutex_record, rwlock_record, pthread_record;
+static size_t torn, writes, stop;
+
+static inline void record_update(record_t *record)
+{
+    record->a++;
+    record->b += 2;
+    record->c += 3;
+    record->sum = record->a + record->b + record->c;
+}
+
+static void *writer(void *arg)
+{
+    (void) arg;
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        afl_seqlock_write_lock(&seqlock);
+        record_update(&seqlock_record);
+        afl_seqlock_write_unlock(&seqlock);
+
+        afl_mutex_lock(&mutex);
+        record_update(&mutex_record);
+        afl_mutex_unlock(&mutex);
+
+        afl_rwlock_exclusive_lock(&rwlock);
+        record_update(&rwlock_record);
+        afl_rwlock_exclusive_unlock(&rwlock);
+
+        pthread_rwlock_wrlock(&prwlock);
+        record_update(&pthread_record);
+        pthread_rwlock_unlock(&prwlock);
+
+        writes++;
+        usleep(WRITE_PERIOD_US);
+    }
+
+    return NULL;
+}
+
+#define BENCHMARK_READER(name, read)                                                   \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        record_t copy;                                                                 \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            read;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            if (copy.a + copy.b + copy.c != copy.sum)                                  \
+                __atomic_add_fetch(&torn, 1, __ATOMIC_RELAXED);                        \
+            total_sum += copy.sum;                                                     \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_READER(seqlock, afl_seqlock_read(&seqlock, &copy, &seqlock_record, sizeof(copy)))
+BENCHMARK_READER(mutex, ({
+                     afl_mutex_lock(&mutex);
+                     copy = mutex_record;
+                     afl_mutex_unlock(&mutex);
+                 }))
+BENCHMARK_READER(rwlock, ({
+                     afl_rwlock_shared_lock(&rwlock);
+                     copy = rwlock_record;
+                     afl_rwlock_shared_unlock(&rwlock);
+                 }))
+BENCHMARK_READER(pthread, ({
+                     pthread_rwlock_rdlock(&prwlock);
+                     copy = pthread_record;
+                     pthread_rwlock_unlock(&prwlock);
+                 }))
+
+int main(void)
+{
+    int max_threads = omp_get_num_procs();
+    pthread_t thread;
+
+    benchmark_info benchmarks[] = {
+      {.name = "seqlock", .func = benchmark_seqlock},
+      {.name = "mutex", .func = benchmark_mutex},
+      {.name = "rwlock", .func = benchmark_rwlock},
+      {.name = "pthread", .func = benchmark_pthread},
+    };
+    size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    pthread_create(&thread, NULL, writer, NULL);
+
+    printf("\n\n\t mean per read, writer period %d us\n", WRITE_PERIOD_US);
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t threads");
+    for (size_t i = 0; i < count; i++)
+        printf("\t %10s", benchmarks[i].name);
+    printf("\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+        omp_set_num_threads(threads);
+        printf("\t %7d", threads);
+        for (size_t i = 0; i < count; i++) {
+            do_bench(&benchmarks[i]);
+            printf("\t %10.2f", benchmarks[i].mean);
+        }
+        printf("\n");
+        if (threads == max_threads)
+            break;
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t iterations: %d x %d trials, affinity: %s\n", RUNS_COUNT * RUN_ITERATIONS, TRIALS_COUNT, affinity_mode());
+    printf("\t writes: %zu, torn reads: %zu\n", writes, torn);
+    printf("\n\n");
+
+    return 0;
+}
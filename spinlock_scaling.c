@@ -0,0 +1,103 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 10000
+#define RUN_ITERATIONS 8
+#include "benchmark.h"
+
+#define FIBONACCI_MAX_VALUE 12
+
+static afl_spinlock_t exchange_spinlock;
+static afl_spinlock_t ttas_spinlock;
+static afl_spinlock_t ticket_spinlock;
+static afl_spin_mcs_t mcs_spinlock = AFL_SPIN_MCS_INIT;
+static pthread_spinlock_t pthread_spinlock;
+
+#define BENCHMARK_SPINLOCK(name, lock, unlock)                                         \
+    static timing_t benchmark_##name(size_t iters)                                     \
+    {                                                                                  \
+        timing_t start, stop, duration = 0;                                            \
+        size_t total_sum = 0;                                                          \
+        afl_spin_mcs_node_t node;                                                      \
+        (void) node;                                                                   \
+                                                                                       \
+        for (size_t i = 0; i < iters; i++) {                                           \
+            TIMING_NOW(start);                                                         \
+            lock;                                                                      \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_DIFF(duration, start, stop);                                    \
+            total_sum += fibonacci(FIBONACCI_MAX_VALUE - i);                           \
+            TIMING_NOW(start);                                                         \
+            unlock;                                                                    \
+            TIMING_NOW(stop);                                                          \
+            TIMING_ADD_RELEASE(duration, start, stop);                                 \
+        }                                                                              \
+                                                                                       \
+        fprintf(stderr, "Total: %zu, Duration: %.2f\n", total_sum, (double) duration); \
+                                                                                       \
+        return duration;                                                               \
+    }
+
+BENCHMARK_SPINLOCK(exchange, afl_spin_exchange_lock(&exchange_spinlock), afl_spin_exchange_unlock(&exchange_spinlock))
+BENCHMARK_SPINLOCK(ttas, afl_spin_ttas_lock(&ttas_spinlock), afl_spin_ttas_unlock(&ttas_spinlock))
+BENCHMARK_SPINLOCK(ticket, afl_spin_ticket_lock(&ticket_spinlock), afl_spin_ticket_unlock(&ticket_spinlock))
+BENCHMARK_SPINLOCK(mcs, afl_spin_mcs_lock(&mcs_spinlock, &node), afl_spin_mcs_unlock(&mcs_spinlock, &node))
+BENCHMARK_SPINLOCK(pthread, pthread_spin_lock(&pthread_spinlock), pthread_spin_unlock(&pthread_spinlock))
+
+int main(void)
+{
+    int max_threads = omp_get_num_procs();
+
+    benchmark_info benchmarks[] = {
+      {.name = "exchange", .func = benchmark_exchange},
+      {.name = "ttas", .func = benchmark_ttas},
+      {.name = "ticket", .func = benchmark_ticket},
+      {.name = "mcs", .func = benchmark_mcs},
+      {.name = "pthread", .func = benchmark_pthread},
+    };
+    size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    afl_spin_init(&exchange_spinlock, 0);
+    afl_spin_init(&ttas_spinlock, 0);
+    afl_spin_init(&ticket_spinlock, 0);
+    pthread_spin_init(&pthread_spinlock, 0);
+
+    printf("\n\n\t mean per lock/unlock pair\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t threads");
+    for (size_t i = 0; i < count; i++)
+        printf("\t %10s", benchmarks[i].name);
+    printf("\n");
+    printf("\t---------------------------------------------------------------------------------\n");
+
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+        omp_set_num_threads(threads);
+        printf("\t %7d", threads);
+        for (size_t i = 0; i < count; i++) {
+            do_bench(&benchmarks[i]);
+            printf("\t %10.2f", benchmarks[i].mean);
+        }
+        printf("\n");
+        if (threads == max_threads)
+            break;
+    }
+
+    printf("\t---------------------------------------------------------------------------------\n");
+    printf("\t iterations: %d x %d trials, affinity: %s\n", RUNS_COUNT * RUN_ITERATIONS, TRIALS_COUNT, affinity_mode());
+    printf("\n\n");
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <linux/futex.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "afl.h"
+
+#define RUNS_COUNT 16
+#define RUN_ITERATIONS 16
+#include "benchmark.h"
+
+#define PARK_DELAY_US 100
+
+/*
+ * The releaser holds every mutex and unlocks one of them once the waiter is parked in the wait.
+ * A round measures the time from that unlock until the waiter owns the mutex, which is then handed back.
+ */
+static uint32_t objects_count;
+
+typedef int (*wait_function_t)(afl_mutex_t *const *, uint32_t, uint32_t *);
+
+typedef struct
+{
+    afl_mutex_t *pointers[AFL_WAIT_MAX];
+    wait_function_t wait;
+    timing_t acquired;
+    size_t waiting;
+    size_t done;
+    int stop;
+} wait_context;
+
+static void wait_counter(size_t *counter, size_t value)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < value)
+        sched_yield();
+}
+
+static int futex_waitv_wait(afl_mutex_t *const *mutexes, uint32_t count, uint32_t *index)
+{
+    return afl_lock_any(mutexes, count, index, NULL);
+}
+
+static int polling_wait(afl_mutex_t *const *mutexes, uint32_t count, uint32_t *index)
+{
+    afl_wait_object_t objects[AFL_WAIT_MAX];
+
+    for (uint32_t i = 0; i < count; i++)
+        objects[i] = AFL_WAIT_MUTEX_OBJECT(mutexes[i]);
+
+    return __afl_wait_any_poll(objects, count, index, NULL);
+}
+
+static void *waiter(void *arg)
+{
+    wait_context *ctx = arg;
+    uint32_t index;
+
+    for (;;) {
+        __atomic_add_fetch(&ctx->waiting, 1, __ATOMIC_RELEASE);
+        ctx->wait(ctx->pointers, objects_count, &index);
+        TIMING_NOW(ctx->acquired);
+        if (__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+            afl_mutex_unlock(ctx->pointers[index]);
+            break;
+        }
+        __atomic_add_fetch(&ctx->done, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static timing_t benchmark_wait(size_t iters, wait_function_t wait)
+{
+    timing_t start, duration = 0;
+    pthread_t thread;
+    wait_context *ctx = calloc(1, sizeof(wait_context));
+
+    ctx->wait = wait;
+    for (uint32_t i = 0; i < objects_count; i++) {
+        ctx->pointers[i]  = aligned_alloc(_Alignof(afl_mutex_t), _Alignof(afl_mutex_t));
+        *ctx->pointers[i] = AFL_MUTEX_INIT;
+        afl_mutex_lock(ctx->pointers[i]);
+    }
+
+    pthread_create(&thread, NULL, waiter, ctx);
+
+    for (size_t i = 0; i < iters; i++) {
+        afl_mutex_t *mutex = ctx->pointers[(i * 7) % objects_count];
+
+        wait_counter(&ctx->waiting, i + 1);
+        usleep(PARK_DELAY_US);
+        TIMING_NOW(start);
+        afl_mutex_unlock(mutex);
+        wait_counter(&ctx->done, i + 1);
+        TIMING_ADD_CROSS_DIFF(duration, start, ctx->acquired);
+    }
+
+    wait_counter(&ctx->waiting, iters + 1);
+    __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELEASE);
+    afl_mutex_unlock(ctx->pointers[0]);
+    pthread_join(thread, NULL);
+
+    for (uint32_t i = 1; i < objects_count; i++)
+        afl_mutex_unlock(ctx->pointers[i]);
+    for (uint32_t i = 0; i < objects_count; i++) {
+        afl_mutex_destroy(ctx->pointers[i]);
+        free(ctx->pointers[i]);
+    }
+
+    free(ctx);
+
+    fprintf(stderr, "Objects: %u, Duration: %.2f\n", objects_count, (double) duration);
+
+    return duration;
+}
+
+static timing_t benchmark_polling(size_t iters)
+{
+    return benchmark_wait(iters, polling_wait);
+}
+
+static timing_t benchmark_futex_waitv(size_t iters)
+{
+    return benchmark_wait(iters, futex_waitv_wait);
+}
+
+int main(void)
+{
+    for (objects_count = 1; objects_count <= AFL_WAIT_MAX; objects_count *= 2) {
+        benchmark_info polling     = {.func = benchmark_polling};
+        benchmark_info futex_waitv  = {.func = benchmark_futex_waitv};
+
+        snprintf(polling.name, sizeof(polling.name), "polling x%u", objects_count);
+        snprintf(futex_waitv.name, sizeof(futex_waitv.name), "futex_waitv x%u", objects_count);
+
+        do_bench(&polling);
+        do_bench(&futex_waitv);
+
+        print_benchmark(futex_waitv, polling);
+    }
+
+    return 0;
+}